@@ -0,0 +1,63 @@
+#include "audio_ring.h"
+
+void audio_ring_init(audio_ring_t *ring)
+{
+    memset(ring->samples, 0, sizeof(ring->samples));
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->last = 0;
+    atomic_init(&ring->underruns, 0);
+    atomic_init(&ring->overruns, 0);
+}
+
+// Producer: copy in as many samples as fit, the rest are dropped and counted
+size_t audio_ring_push(audio_ring_t *ring, const i16 *samples, size_t count)
+{
+    u32 head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t space = AUDIO_RING_SIZE - (head - tail);
+
+    if (count > space) {
+        atomic_fetch_add_explicit(&ring->overruns, 1, memory_order_relaxed);
+        count = space;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ring->samples[(head + i) & (AUDIO_RING_SIZE - 1)] = samples[i];
+    }
+
+    // Publish the samples before the new head
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+// Consumer: fill samples, padding with the last value when the ring runs dry so
+// an underrun is a gap rather than a click
+size_t audio_ring_pop(audio_ring_t *ring, i16 *samples, size_t count)
+{
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t available = head - tail;
+    size_t taken = count < available ? count : available;
+
+    for (size_t i = 0; i < taken; i++) {
+        samples[i] = ring->samples[(tail + i) & (AUDIO_RING_SIZE - 1)];
+    }
+    if (taken) ring->last = samples[taken - 1];
+
+    if (taken < count) {
+        atomic_fetch_add_explicit(&ring->underruns, 1, memory_order_relaxed);
+        for (size_t i = taken; i < count; i++) samples[i] = ring->last;
+    }
+
+    atomic_store_explicit(&ring->tail, tail + taken, memory_order_release);
+    return taken;
+}
+
+// Samples waiting to be played, safe to read from either side
+size_t audio_ring_fill(audio_ring_t *ring)
+{
+    u32 head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    u32 tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
@@ -0,0 +1,28 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include "utils/util.h"
+#include <stdatomic.h>
+
+#define AUDIO_RING_SIZE 8192   // Samples, a power of two (about 170 ms at 48 kHz)
+
+// Lock-free single-producer/single-consumer sample ring. The emulation thread
+// pushes each frame's samples, the audio callback pops what the device asks for.
+// Indices only ever grow, their difference is the fill level.
+typedef struct
+{
+    i16 samples[AUDIO_RING_SIZE];
+    atomic_uint head;        // Written by the producer
+    atomic_uint tail;        // Written by the consumer
+    i16 last;                // Last sample handed out, repeated on underrun
+
+    atomic_uint underruns;   // Pops the ring couldn't fill
+    atomic_uint overruns;    // Pushes that dropped samples on a full ring
+} audio_ring_t;
+
+void audio_ring_init(audio_ring_t *ring);
+size_t audio_ring_push(audio_ring_t *ring, const i16 *samples, size_t count);
+size_t audio_ring_pop(audio_ring_t *ring, i16 *samples, size_t count);
+size_t audio_ring_fill(audio_ring_t *ring);
+
+#endif
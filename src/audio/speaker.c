@@ -0,0 +1,109 @@
+#include "speaker.h"
+
+#include <math.h>
+
+// Step kernel: each phase is a Blackman-windowed sinc shifted by a fraction of a
+// sample, normalized so a click's deltas always sum to its full height
+static float kernel[SPEAKER_PHASES][SPEAKER_TAPS];
+
+static void build_kernel(void)
+{
+    const double cutoff = 0.45;  // Cycles per sample, just under Nyquist
+
+    for (int phase = 0; phase < SPEAKER_PHASES; phase++) {
+        double offset = (double)phase / SPEAKER_PHASES;
+        double total = 0;
+
+        for (int tap = 0; tap < SPEAKER_TAPS; tap++) {
+            double x = tap - SPEAKER_TAPS / 2 - offset;
+            double sinc = x == 0 ? 1 : sin(2 * M_PI * cutoff * x) / (2 * M_PI * cutoff * x);
+            double w = (x + SPEAKER_TAPS / 2) / SPEAKER_TAPS;
+            double window = 0.42 - 0.5 * cos(2 * M_PI * w) + 0.08 * cos(4 * M_PI * w);
+            kernel[phase][tap] = sinc * window;
+            total += kernel[phase][tap];
+        }
+        for (int tap = 0; tap < SPEAKER_TAPS; tap++) kernel[phase][tap] /= total;
+    }
+}
+
+speaker_t *speaker_create(u32 clock_hz, u32 sample_rate)
+{
+    static bool ready = false;
+    if (!ready) {
+        build_kernel();
+        ready = true;
+    }
+
+    speaker_t *speaker = calloc(1, sizeof(*speaker));
+    if (!speaker) return NULL;
+
+    speaker->samples_per_cycle = (double)sample_rate / clock_hz;
+    speaker->level = SPEAKER_VOLUME;
+    speaker->sum = SPEAKER_VOLUME;
+    return speaker;
+}
+
+void speaker_destroy(speaker_t *speaker)
+{
+    free(speaker);
+}
+
+// Drop pending clicks and restart the sample clock, for when global_cycles jumps
+// (rewind, state load) or the emulator fell too far behind to catch up
+void speaker_reset(speaker_t *speaker, u64 cycles)
+{
+    memset(speaker->deltas, 0, sizeof(speaker->deltas));
+    speaker->base_cycles = cycles;
+    speaker->sum = speaker->level;
+}
+
+// $C030: flip the cone, spreading the step over the taps around its exact time
+void speaker_toggle(speaker_t *speaker, u64 cycles)
+{
+    double time = ((double)cycles - speaker->base_cycles) * speaker->samples_per_cycle;
+    float step = -2 * speaker->level;
+    speaker->level = -speaker->level;
+
+    // Outside the buffer the click is lost, render resyncs on the next frame
+    if (time < 0 || time >= SPEAKER_BUFFER) return;
+
+    int sample = (int)time;
+    const float *taps = kernel[(int)((time - sample) * SPEAKER_PHASES)];
+    float *deltas = speaker->deltas + sample;
+    for (int tap = 0; tap < SPEAKER_TAPS; tap++) deltas[tap] += step * taps[tap];
+}
+
+// Integrate the deltas up to cycles into 16-bit samples, returns how many
+size_t speaker_render(speaker_t *speaker, u64 cycles, i16 *samples, size_t max)
+{
+    double ready = ((double)cycles - speaker->base_cycles) * speaker->samples_per_cycle;
+    if (ready < 0 || ready > SPEAKER_BUFFER) {
+        speaker_reset(speaker, cycles);
+        return 0;
+    }
+
+    size_t count = (size_t)ready;
+    if (count > max) count = max;
+
+    for (size_t i = 0; i < count; i++) {
+        speaker->sum += speaker->deltas[i];
+
+        // One-pole high-pass, a held cone is silence
+        float out = speaker->sum - speaker->dc_in + 0.998f * speaker->dc_out;
+        speaker->dc_in = speaker->sum;
+        speaker->dc_out = out;
+
+        float scaled = out * 32767.0f;
+        if (scaled > 32767.0f) scaled = 32767.0f;
+        if (scaled < -32768.0f) scaled = -32768.0f;
+        samples[i] = (i16)scaled;
+    }
+
+    // Slide the clicks still to come down to the start of the buffer
+    size_t remaining = SPEAKER_BUFFER + SPEAKER_TAPS - count;
+    memmove(speaker->deltas, speaker->deltas + count, remaining * sizeof(float));
+    memset(speaker->deltas + remaining, 0, count * sizeof(float));
+    speaker->base_cycles += count / speaker->samples_per_cycle;
+
+    return count;
+}
@@ -0,0 +1,35 @@
+#ifndef SPEAKER_H
+#define SPEAKER_H
+
+#include "utils/util.h"
+
+// Speaker Defines
+#define SPEAKER_ADDR 0xC030
+#define AUDIO_SAMPLE_RATE 48000
+#define SPEAKER_VOLUME 0.25f         // Cone swing as a fraction of full scale
+
+// Band-limited step synthesis
+#define SPEAKER_TAPS 16              // Samples each click is spread over
+#define SPEAKER_PHASES 32            // Sub-sample positions of the step kernel
+#define SPEAKER_BUFFER 4096          // Samples rendered at most per call, over a frame's worth
+
+// Clicks are added to a buffer of sample-rate deltas as they happen, each one
+// spread through a windowed-sinc kernel, and integrated into samples per frame
+typedef struct
+{
+    float deltas[SPEAKER_BUFFER + SPEAKER_TAPS];
+    double base_cycles;          // global_cycles at deltas[0], fractional
+    double samples_per_cycle;
+    float level;                 // Cone position, +-SPEAKER_VOLUME
+    float sum;                   // Running integral of the deltas
+    float dc_in;                 // DC blocker state, the cone drifts back to rest
+    float dc_out;
+} speaker_t;
+
+speaker_t *speaker_create(u32 clock_hz, u32 sample_rate);
+void speaker_destroy(speaker_t *speaker);
+void speaker_reset(speaker_t *speaker, u64 cycles);
+void speaker_toggle(speaker_t *speaker, u64 cycles);
+size_t speaker_render(speaker_t *speaker, u64 cycles, i16 *samples, size_t max);
+
+#endif
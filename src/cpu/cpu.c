@@ -3,6 +3,36 @@
 
 static FILE *log = NULL;
 
+// The CPU is too big for the stack and wants its hot fields cache line aligned
+cpu_t *cpu_create(void)
+{
+    cpu_t *cpu = aligned_alloc(_Alignof(cpu_t), sizeof(cpu_t));
+    if (!cpu) {
+        fprintf(stderr, "Error: Could not allocate the CPU\n");
+        return NULL;
+    }
+    memset(cpu, 0, sizeof(*cpu));
+
+    cpu->disk_ctrl = disk_controller_create();
+    if (!cpu->disk_ctrl) {
+        fprintf(stderr, "Error: Could not allocate the disk controller\n");
+        free(cpu);
+        return NULL;
+    }
+
+    cpu_init(cpu);
+    return cpu;
+}
+
+// Writes back and unmounts the disks, and frees the attached speaker
+void cpu_destroy(cpu_t *cpu)
+{
+    if (!cpu) return;
+    disk_controller_destroy(cpu->disk_ctrl);
+    speaker_destroy(cpu->speaker);
+    free(cpu);
+}
+
 void cpu_init(cpu_t *cpu)
 {
     // Clear Memory
@@ -13,9 +43,12 @@ void cpu_init(cpu_t *cpu)
     cpu->SP = 0xFF;
     cpu->A = cpu->X = cpu->Y = 0;
 
-    // Status flags
-    cpu->N = cpu->V = cpu->D = cpu->C = 0;
-    cpu->B = cpu->I = cpu->Z = 1;
+    // Status flags (Z set, N/V/C clear)
+    cpu->D = 0;
+    cpu->B = cpu->I = 1;
+    cpu->nz_result = 0;
+    cpu->c_result = 0;
+    cpu->v_result = 0;
 
     // Keyboard State
     cpu->key_ready = false;
@@ -24,40 +57,28 @@ void cpu_init(cpu_t *cpu)
     // Global State
     cpu->running = true;
     cpu->global_cycles = 0;
+    cpu->cycle_deadline = 0;
+
+    // Idle Detection
+    cpu->idle_skip = true;
+    cpu->poll_pc = 0;
+    cpu->poll_count = 0;
+    cpu->poll_cycles = 0;
+    cpu->activity = 0;
+    cpu->poll_activity = 0;
 
     // Rendering State
     cpu->text_mode = true;
     cpu->low_res = false;
     cpu->high_res = false;
     cpu->mixed_mode = false;
-}
+    memset(cpu->text_dirty, 0, sizeof(cpu->text_dirty));
+    memset(cpu->hires_dirty, 0, sizeof(cpu->hires_dirty));
 
-void cpu_cycle(cpu_t *cpu)
-{
-    // Debug Function (Prints CPU State to file)
-    // cpu_display_registers(cpu);
-    u8 opcode_byte = read_memory(cpu, cpu->PC++);
-    opcode_t opcode = opcodes[opcode_byte];
-    u16 addr = 0;
-
-    switch (opcode.addr_mode) {
-        case IMM: addr = imm_address(cpu); break;
-        case ZP:  addr = zp_address(cpu);  break;
-        case ZPX: addr = zpx_address(cpu); break;
-        case ZPY: addr = zpy_address(cpu); break;
-        case ABS: addr = abs_address(cpu); break;
-        case ABX: addr = abx_address(cpu); break;
-        case ABY: addr = aby_address(cpu); break;
-        case IND: addr = ind_address(cpu); break;
-        case IDX: addr = indx_address(cpu); break;
-        case IDY: addr = indy_address(cpu); break;
-        case IMP: addr = imp_address(cpu); break;
-        case REL: addr = rel_address(cpu); break;
-    }
-
-    opcode.operation(cpu, addr);
-    //usleep(1 * opcode.cycles);
-    cpu->global_cycles += opcode.cycles;
+    cpu->rwts_cycles = 0;
+    cpu->speaker = NULL;
+
+    memory_map_init(cpu);
 }
 
 bool load_program(cpu_t *cpu, const char* rom_path, u16 address)
@@ -96,21 +117,12 @@ bool load_program(cpu_t *cpu, const char* rom_path, u16 address)
 bool init_software(cpu_t *cpu)
 {
     // Load Apple2_Plus rom
-    if (!load_program(cpu, "./roms/Apple2_Plus.Rom", 0xD000))
+    if (!load_program(cpu, "./roms/Apple2_Plus.rom", 0xD000))
     {
         fprintf(stderr, "Error: Could not load ROM\n");
         return false;
     }
 
-    // Load Disk2 Rom, put it in slot 6
-    /*
-    if (!load_program(cpu, "./roms/DISK2.rom", 0xC600))
-    {
-        fprintf(stderr, "Error, Could not load Disk Interface\n");
-        return false;
-    }
-    */
-
     // Set NMI, Reset, & BRK Locations
     cpu->NMI_LOC = (cpu->memory[NMI_HIGH_ADDR] << 8) | cpu->memory[NMI_LOW_ADDR];
     cpu->RESET_LOC = (cpu->memory[RESET_HIGH_ADDR] << 8) | cpu->memory[RESET_LOW_ADDR];
@@ -120,129 +132,249 @@ bool init_software(cpu_t *cpu)
     return true;
 }
 
-u8 read_memory(cpu_t *cpu, u16 address)
+// Mount the given images and put the Disk II ROM in slot 6. Without a disk the
+// ROM is left out, otherwise the autostart ROM would spin on an empty drive.
+bool init_disks(cpu_t *cpu, const char *disk1_path, const char *disk2_path)
 {
-    // Read IO Space
-    if (address >= 0xC000 && address <= 0xC0FF) {
-        switch (address) {
-            // Return Key Value
-            case 0xC000:
-                if (cpu->key_ready) {
-                    return cpu->key_value | NEGATIVE_FLAG;
-                }
-                return 0;
-            // Clear Key Press
-            case 0xC010:
-                cpu->key_ready = false;
-                return 0;
-            // Clear Text Mode
-            case 0xC050:
-                cpu->text_mode = false; 
-                return 0;
-            // Set Text Mode
-            case 0xC051:
-                cpu->text_mode = true; 
-                return 0;
-            // Set Full Screen
-            case 0xC052:
-                cpu->mixed_mode = false; 
-                return 0; 
-            // Set Mixed Mode
-            case 0xC053:
-                cpu->mixed_mode = true;  
-                return 0;
-            // Set Page 1
-            case 0xC054:
-                return 0;
-            // Set Page 2
-            case 0xC055:
-                return 0;
-            // Set Low-Res
-            case 0xC056:
-                cpu->low_res = true;  
-                cpu->high_res = false; 
-                return 0; 
-            // Set High-Res
-            case 0xC057:
-                cpu->low_res = false; 
-                cpu->high_res = true;  
-                return 0;
-            
-            // Disk II IO
-            case 0xC0EC:
-                return read_disk_register(&cpu->drive1);
-        }
+    if (!disk1_path && !disk2_path) return true;
+
+    if (disk1_path && !load_disk(cpu->disk_ctrl->drives[0], disk1_path)) return false;
+    if (disk2_path && !load_disk(cpu->disk_ctrl->drives[1], disk2_path)) return false;
 
-        return 0;
+    // Load Disk2 Rom, put it in slot 6
+    if (!load_program(cpu, "./roms/DISK2.rom", DISK_ROM_ADDR))
+    {
+        fprintf(stderr, "Error, Could not load Disk Interface\n");
+        return false;
     }
-    
 
-    return cpu->memory[address];
+    return true;
+}
+
+void map_pages(cpu_t *cpu, u8 first, u8 last, u8 *read, u8 *write)
+{
+    for (int page = first; page <= last; page++) {
+        int offset = (page - first) * PAGE_SIZE;
+        cpu->read_pages[page] = read ? read + offset : NULL;
+        cpu->write_pages[page] = write ? write + offset : NULL;
+    }
 }
 
-void write_memory(cpu_t *cpu, u16 address, u8 value)
+// KEYIN: INC RNDL, BNE +2, INC RNDH, BIT $C000, BPL KEYIN
+static const u8 keyin_loop[] = { 0xE6, 0x4E, 0xD0, 0x02, 0xE6, 0x4F, 0x2C, 0x00, 0xC0, 0x10, 0xF5 };
+
+// The poll is KEYIN's when PC has just passed the BIT operand inside the Monitor's loop
+static bool polling_keyin(const cpu_t *cpu)
 {
-    // Read IO Space
-    if (address >= 0xC000 && address <= 0xC0FF) {
-        switch (address) {
-            // Clear Key Press
-            case 0xC010:
-                cpu->key_ready = false;
-                return;
-            // Clear Text Mode
-            case 0xC050:
-                cpu->text_mode = false; 
-                return;
-            // Set Text Mode
-            case 0xC051:
-                cpu->text_mode = true; 
-                return;
-            // Set Full Screen
-            case 0xC052:
-                cpu->mixed_mode = false; 
-                return; 
-            // Set Mixed Mode
-            case 0xC053:
-                cpu->mixed_mode = true;  
-                return;
-            // Set Page 1
-            case 0xC054:
-                return;
-            // Set Page 2
-            case 0xC055:
-                return;
-            // Set Low-Res
-            case 0xC056:
-                cpu->low_res = true;  
-                cpu->high_res = false; 
-                return; 
-            // Set High-Res
-            case 0xC057:
-                cpu->low_res = false; 
-                cpu->high_res = true;  
-                return;
+    return cpu->PC == KEYIN_ADDR + sizeof(keyin_loop) - 2
+        && memcmp(cpu->memory + KEYIN_ADDR, keyin_loop, sizeof(keyin_loop)) == 0;
+}
+
+// Called on every empty keyboard poll. Once the same instruction has polled
+// back-to-back enough times without writing RAM or touching other I/O in between,
+// nothing can change until the next keypress arrives between frames, so jump ahead.
+// KEYIN is the one loop let through with its writes: its seed is advanced by the
+// iterations skipped, as if they had run.
+static void detect_idle(cpu_t *cpu)
+{
+    if (!cpu->idle_skip) return;
+
+    u64 loop_cycles = cpu->global_cycles - cpu->poll_cycles;
+    u32 activity = cpu->activity - cpu->poll_activity;
+    bool keyin = activity <= 2 && polling_keyin(cpu);
+
+    if (cpu->PC == cpu->poll_pc && loop_cycles && loop_cycles <= IDLE_LOOP_CYCLES && (!activity || keyin)) {
+        if (cpu->poll_count < IDLE_POLL_THRESHOLD) {
+            cpu->poll_count++;
+        } else if (cpu->global_cycles < cpu->cycle_deadline) {
+            if (keyin) {
+                u16 seed = cpu->memory[RNDL_ADDR] | (cpu->memory[RNDL_ADDR + 1] << 8);
+                seed += (cpu->cycle_deadline - cpu->global_cycles) / loop_cycles;
+                cpu->memory[RNDL_ADDR] = seed & 0xFF;
+                cpu->memory[RNDL_ADDR + 1] = seed >> 8;
+            }
+            cpu->global_cycles = cpu->cycle_deadline;
+            cpu->poll_count = 0;
         }
+    } else {
+        cpu->poll_count = 0;
+    }
 
+    cpu->poll_pc = cpu->PC;
+    cpu->poll_cycles = cpu->global_cycles;
+    cpu->poll_activity = cpu->activity;
+}
+
+// Soft Switches ($C000-$C0FF)
+static u8 io_read(cpu_t *cpu, u16 address)
+{
+    // Every soft switch but the keyboard has side effects, polling loops that touch one aren't idle
+    if (address != 0xC000) cpu->activity++;
+
+    // Disk II IO
+    if (address >= DISK_IO_START && address <= DISK_IO_END) {
+        return disk_controller_read(cpu->disk_ctrl, address, cpu->global_cycles);
+    }
+
+    switch (address) {
+        // Return Key Value
+        case 0xC000:
+            if (cpu->key_ready) {
+                return cpu->key_value | NEGATIVE_FLAG;
+            }
+            detect_idle(cpu);
+            return 0;
+        // Clear Key Press
+        case 0xC010:
+            cpu->key_ready = false;
+            return 0;
+        // Toggle Speaker
+        case SPEAKER_ADDR:
+            if (cpu->speaker) speaker_toggle(cpu->speaker, cpu->global_cycles);
+            return 0;
+        // Clear Text Mode
+        case 0xC050:
+            cpu->text_mode = false; 
+            return 0;
+        // Set Text Mode
+        case 0xC051:
+            cpu->text_mode = true; 
+            return 0;
+        // Set Full Screen
+        case 0xC052:
+            cpu->mixed_mode = false; 
+            return 0; 
+        // Set Mixed Mode
+        case 0xC053:
+            cpu->mixed_mode = true;  
+            return 0;
+        // Set Page 1
+        case 0xC054:
+            return 0;
+        // Set Page 2
+        case 0xC055:
+            return 0;
+        // Set Low-Res
+        case 0xC056:
+            cpu->low_res = true;  
+            cpu->high_res = false; 
+            return 0; 
+        // Set High-Res
+        case 0xC057:
+            cpu->low_res = false; 
+            cpu->high_res = true;  
+            return 0;
+    }
+
+    return 0;
+}
+
+static void io_write(cpu_t *cpu, u16 address, u8 value)
+{
+    // Disk II IO
+    if (address >= DISK_IO_START && address <= DISK_IO_END) {
+        disk_controller_write(cpu->disk_ctrl, address, value, cpu->global_cycles);
         return;
     }
 
-    // Protect Writing to ROM
-    if (address >= 0xD000) return;
+    switch (address) {
+        // Clear Key Press
+        case 0xC010:
+            cpu->key_ready = false;
+            return;
+        // Toggle Speaker
+        case SPEAKER_ADDR:
+            if (cpu->speaker) speaker_toggle(cpu->speaker, cpu->global_cycles);
+            return;
+        // Clear Text Mode
+        case 0xC050:
+            cpu->text_mode = false; 
+            return;
+        // Set Text Mode
+        case 0xC051:
+            cpu->text_mode = true; 
+            return;
+        // Set Full Screen
+        case 0xC052:
+            cpu->mixed_mode = false; 
+            return; 
+        // Set Mixed Mode
+        case 0xC053:
+            cpu->mixed_mode = true;  
+            return;
+        // Set Page 1
+        case 0xC054:
+            return;
+        // Set Page 2
+        case 0xC055:
+            return;
+        // Set Low-Res
+        case 0xC056:
+            cpu->low_res = true;  
+            cpu->high_res = false; 
+            return; 
+        // Set High-Res
+        case 0xC057:
+            cpu->low_res = false; 
+            cpu->high_res = true;  
+            return;
+    }
+}
 
+// Display memory: store the byte and flag its text row or hi-res scanline as dirty
+static void video_write(cpu_t *cpu, u16 address, u8 value)
+{
+    if (cpu->memory[address] == value) return;
     cpu->memory[address] = value;
+
+    // Each 128-byte block holds three 40-byte rows plus 8 unused "screen hole" bytes
+    u16 offset = address & (address < HIRES_PAGE_START ? 0x03FF : 0x1FFF);
+    u8 column = offset & 0x7F;
+    if (column >= 120) return;
+
+    u8 third = column / 40;
+
+    if (address <= TEXT_PAGE_END) {
+        u8 row = ((offset >> 7) & 7) + third * 8;
+        cpu->text_dirty[(address >> 10) - 1] |= 1u << row;
+    } else {
+        u8 line = ((offset >> 7) & 7) * 8 + (offset >> 10);
+        cpu->hires_dirty[(address >> 13) - 1][third] |= 1ull << line;
+    }
+}
+
+void memory_map_init(cpu_t *cpu)
+{
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        cpu->io_read[page] = io_read;
+        cpu->io_write[page] = io_write;
+    }
+
+    // RAM ($0000-$BFFF)
+    map_pages(cpu, 0x00, 0xBF, cpu->memory, cpu->memory);
+
+    // Display pages are read directly but written through video_write
+    map_pages(cpu, TEXT_PAGE_START >> 8, TEXT_PAGE_END >> 8, cpu->memory + TEXT_PAGE_START, NULL);
+    map_pages(cpu, HIRES_PAGE_START >> 8, HIRES_PAGE_END >> 8, cpu->memory + HIRES_PAGE_START, NULL);
+    for (int page = TEXT_PAGE_START >> 8; page <= TEXT_PAGE_END >> 8; page++) {
+        cpu->io_write[page] = video_write;
+    }
+    for (int page = HIRES_PAGE_START >> 8; page <= HIRES_PAGE_END >> 8; page++) {
+        cpu->io_write[page] = video_write;
+    }
+
+    // Soft Switches ($C000-$C0FF) only go through the I/O handlers
+    map_pages(cpu, IO_PAGE, IO_PAGE, NULL, NULL);
+
+    // Slot & System ROM ($C100-$FFFF), writes are discarded
+    for (int page = IO_PAGE + 1; page < PAGE_COUNT; page++) {
+        cpu->read_pages[page] = cpu->memory + page * PAGE_SIZE;
+        cpu->write_pages[page] = cpu->rom_sink;
+    }
 }
 
 void cpu_display_registers(cpu_t *cpu) {
-    u8 value = 0;
-
-    value |= cpu->C ? CARRY_FLAG : 0;  
-    value |= cpu->Z ? ZERO_FLAG : 0;  
-    value |= cpu->I ? INTERRUPT_FLAG : 0;  
-    value |= cpu->D ? DECIMAL_FLAG : 0;  
-    value |= BREAK_FLAG;
-    value |= 0x20;               
-    value |= cpu->V ? OVERFLOW_FLAG : 0;  
-    value |= cpu->N ? NEGATIVE_FLAG : 0;  
+    u8 value = get_status(cpu);
 
     if (!log) log = fopen("trace.log", "w");
     fprintf(log, "A: %02X, X: %02X, Y: %02X, PC: %04X, SP: %02X, SR: %02X\n",
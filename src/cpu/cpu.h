@@ -3,54 +3,168 @@
 
 #include "utils/util.h"
 #include "disk/disk.h"
+#include "audio/speaker.h"
+
+#include <stddef.h>
 
 #define CYCLES_PER_FRAME 17030 // 1.023 MHz / 60 FPS
+#define CPU_CLOCK_HZ 1020484   // NTSC Apple II average clock (17030 cycles = one 59.92 Hz frame)
+
+// Memory Map Defines
+#define PAGE_COUNT 256
+#define PAGE_SIZE 256
+#define IO_PAGE 0xC0
+
+// Video Dirty Tracking Defines
+#define TEXT_PAGE_START 0x0400   // Text / Lo-Res pages 1 & 2 ($0400-$0BFF)
+#define TEXT_PAGE_END 0x0BFF
+#define HIRES_PAGE_START 0x2000  // Hi-Res pages 1 & 2 ($2000-$5FFF)
+#define HIRES_PAGE_END 0x5FFF
+#define ALL_TEXT_ROWS 0x00FFFFFFu
+
+// Idle Detection Defines
+#define IDLE_LOOP_CYCLES 64      // Max cycles between two polls of the same keyboard loop
+#define IDLE_POLL_THRESHOLD 8    // Back-to-back empty polls before we fast-forward
+#define KEYIN_ADDR 0xFD1B        // Monitor KEYIN loop, bumps the RNDL/RNDH seed while it waits
+#define RNDL_ADDR 0x4E
+
+typedef struct cpu_t cpu_t;
+
+// I/O handlers for pages that have no direct pointer in the memory map
+typedef u8 (*io_read_t)(cpu_t *cpu, u16 address);
+typedef void (*io_write_t)(cpu_t *cpu, u16 address, u8 value);
 
-typedef struct
+// Registers, flags and cycle counters share the first cache line and the video state
+// the second, the large tables and memory follow
+struct cpu_t
 {
     // CPU-Related Variables
-    u8 A;   
-    u16 PC; 
-    u8 SP;  
-    u8 X;   
-    u8 Y;   
-    u8 memory[MEMORY_SIZE];
-    u8 N; 
-    u8 V; 
-    u8 B; 
-    u8 D; 
-    u8 I; 
-    u8 Z; 
-    u8 C;
-    
-    // BRK/RESET/NMI Locations
-    u16 BRK_LOC;
-    u16 RESET_LOC;
-    u16 NMI_LOC;
-
-    // Rendering Related Variables
-    bool text_mode;
-    bool low_res;
-    bool mixed_mode;
-    bool high_res;
+    _Alignas(64) u8 A;
+    u8 X;
+    u8 Y;
+    u8 SP;
+    u16 PC;
+    u8 B;
+    u8 D;
+    u8 I;
 
-    // Disks (Emulate 2 Drives)
-    disk_t drive1;
-    disk_t drive2;
+    // Lazy Flags: handlers store raw results, N/Z/C/V are decoded on demand
+    u16 nz_result; // Z = low byte is zero, N = bit 7 or bit 8
+    u16 c_result;  // C = bit 8
+    u8 v_result;   // V = bit 7
 
     // State-Related Variables
     u8 key_value;
     bool key_ready;
     bool running;
     u64 global_cycles;
-} cpu_t;
+    u64 cycle_deadline; // Target of the running cpu_run call
+
+    // Idle Detection: a tight loop polling an empty keyboard skips to cycle_deadline
+    bool idle_skip;
+    u16 poll_pc;
+    u16 poll_count;
+    u64 poll_cycles;
+    u32 activity;       // RAM writes and I/O accesses, a loop making any isn't idle
+    u32 poll_activity;  // activity at the last poll
+
+    // Rendering Related Variables
+    _Alignas(64) bool text_mode;
+    bool low_res;
+    bool mixed_mode;
+    bool high_res;
+
+    // Display rows written since the renderer last cleared them (one bit per row/scanline, per page)
+    u32 text_dirty[2];
+    u64 hires_dirty[2][3];
+
+    // BRK/RESET/NMI Locations
+    u16 BRK_LOC;
+    u16 RESET_LOC;
+    u16 NMI_LOC;
+
+    // Disks: the slot 6 controller owns both drives and their images
+    disk_controller_t *disk_ctrl;
+    u32 rwts_cycles;    // Charged per DOS 3.3 RWTS call when the trap is on
+    speaker_t *speaker; // NULL when sound is off
+
+    // Memory Map: a NULL page pointer routes the access to that page's I/O handler
+    u8 *read_pages[PAGE_COUNT];
+    u8 *write_pages[PAGE_COUNT];
+    io_read_t io_read[PAGE_COUNT];
+    io_write_t io_write[PAGE_COUNT];
+    u8 rom_sink[PAGE_SIZE]; // Discarded writes to ROM
+    u8 memory[MEMORY_SIZE];
+};
+
+_Static_assert(offsetof(cpu_t, text_mode) == 64, "CPU registers and counters must fit one cache line");
+
+
+// Status Flag Access
+static inline u8 flag_n(const cpu_t *cpu) { return (cpu->nz_result & 0x180) != 0; }
+static inline u8 flag_z(const cpu_t *cpu) { return (cpu->nz_result & 0xFF) == 0; }
+static inline u8 flag_c(const cpu_t *cpu) { return (cpu->c_result >> 8) & 1; }
+static inline u8 flag_v(const cpu_t *cpu) { return (cpu->v_result >> 7) & 1; }
+
+static inline void set_flag_c(cpu_t *cpu, u8 on) { cpu->c_result = on ? 0x100 : 0; }
+
+// Packed Status Register (B and bit 5 always read back as set)
+static inline u8 get_status(const cpu_t *cpu)
+{
+    u8 value = BREAK_FLAG | 0x20;
+
+    value |= flag_c(cpu) ? CARRY_FLAG : 0;
+    value |= flag_z(cpu) ? ZERO_FLAG : 0;
+    value |= cpu->I ? INTERRUPT_FLAG : 0;
+    value |= cpu->D ? DECIMAL_FLAG : 0;
+    value |= flag_v(cpu) ? OVERFLOW_FLAG : 0;
+    value |= flag_n(cpu) ? NEGATIVE_FLAG : 0;
+
+    return value;
+}
+
+// Memory access goes through the page tables, only NULL pages call an I/O handler.
+// Inlined so the dispatch engines compile each access into a table lookup.
+static inline u8 read_memory(cpu_t *cpu, u16 address)
+{
+    const u8 *page = cpu->read_pages[address >> 8];
+    if (page) return page[address & 0xFF];
+
+    return cpu->io_read[address >> 8](cpu, address);
+}
+
+static inline void write_memory(cpu_t *cpu, u16 address, u8 value)
+{
+    cpu->activity++;
+
+    u8 *page = cpu->write_pages[address >> 8];
+    if (page) {
+        page[address & 0xFF] = value;
+        return;
+    }
+
+    cpu->io_write[address >> 8](cpu, address, value);
+}
+
+static inline void set_status(cpu_t *cpu, u8 value)
+{
+    cpu->c_result = (value & CARRY_FLAG) << 8;
+    cpu->v_result = (value & OVERFLOW_FLAG) << 1;
+    cpu->nz_result = ((value & ZERO_FLAG) ? 0 : 1) | ((value & NEGATIVE_FLAG) ? 0x100 : 0);
+    cpu->I = (value & INTERRUPT_FLAG) != 0;
+    cpu->D = (value & DECIMAL_FLAG) != 0;
+}
 
+cpu_t *cpu_create(void);
+void cpu_destroy(cpu_t *cpu);
 void cpu_init(cpu_t *cpu);
 void cpu_cycle(cpu_t *cpu);
+void cpu_run(cpu_t *cpu, u64 target_cycles);
 bool load_program(cpu_t *cpu, const char* rom_path, u16 address);
 bool init_software(cpu_t *cpu_);
-u8 read_memory(cpu_t *cpu, u16 address);
-void write_memory(cpu_t *cpu, u16 address, u8 value);
+bool init_disks(cpu_t *cpu, const char *disk1_path, const char *disk2_path);
+void map_pages(cpu_t *cpu, u8 first, u8 last, u8 *read, u8 *write);
+void memory_map_init(cpu_t *cpu);
 
 // Displaying Register & Memory
 void cpu_display_registers(cpu_t *cpu);
@@ -0,0 +1,115 @@
+#include "cpu.h"
+#include "instruction.h"
+
+// Fetch, decode & execute one instruction through the opcodes[] table
+static inline void cpu_step(cpu_t *cpu)
+{
+    // Debug Function (Prints CPU State to file)
+    // cpu_display_registers(cpu);
+    u8 opcode_byte = read_memory(cpu, cpu->PC++);
+    opcode_t opcode = opcodes[opcode_byte];
+    u16 addr = 0;
+
+    // Undocumented opcodes are skipped as 1-byte NOPs, like the threaded engine
+    if (!opcode.operation) {
+        cpu->global_cycles += 2;
+        return;
+    }
+
+    switch (opcode.addr_mode) {
+        case IMM: addr = imm_address(cpu); break;
+        case ZP:  addr = zp_address(cpu);  break;
+        case ZPX: addr = zpx_address(cpu); break;
+        case ZPY: addr = zpy_address(cpu); break;
+        case ABS: addr = abs_address(cpu); break;
+        case ABX: addr = abx_address(cpu); break;
+        case ABY: addr = aby_address(cpu); break;
+        case IND: addr = ind_address(cpu); break;
+        case IDX: addr = indx_address(cpu); break;
+        case IDY: addr = indy_address(cpu); break;
+        case IMP: addr = imp_address(cpu); break;
+        case REL: addr = rel_address(cpu); break;
+    }
+
+    opcode.operation(cpu, addr);
+    //usleep(1 * opcode.cycles);
+    cpu->global_cycles += opcode.cycles;
+}
+
+void cpu_cycle(cpu_t *cpu)
+{
+    cpu_step(cpu);
+}
+
+#if defined(CPU_THREADED_DISPATCH) && defined(__GNUC__)
+
+// Operand fetch for each addressing mode, pasted into the fused handlers
+#define FETCH_IMM imm_address(cpu)
+#define FETCH_ZP  zp_address(cpu)
+#define FETCH_ZPX zpx_address(cpu)
+#define FETCH_ZPY zpy_address(cpu)
+#define FETCH_ABS abs_address(cpu)
+#define FETCH_ABX abx_address(cpu)
+#define FETCH_ABY aby_address(cpu)
+#define FETCH_IND ind_address(cpu)
+#define FETCH_IDX indx_address(cpu)
+#define FETCH_IDY indy_address(cpu)
+#define FETCH_IMP imp_address(cpu)
+#define FETCH_REL (u16)rel_address(cpu)
+
+void cpu_run(cpu_t *cpu, u64 target_cycles)
+{
+    cpu->cycle_deadline = target_cycles;
+
+    // Label table built once from opcodes.def, unused opcodes go to op_illegal
+    static void *dispatch[256];
+    static bool ready = false;
+
+    if (!ready) {
+        for (int i = 0; i < 256; i++) {
+            dispatch[i] = &&op_illegal;
+        }
+#define OP(code, mode, cycles, operation) dispatch[code] = &&op_##code;
+#include "opcodes.def"
+#undef OP
+        ready = true;
+    }
+
+    // Every handler ends by jumping straight to the next one
+#define NEXT()                                            \
+    do {                                                  \
+        if (cpu->global_cycles >= target_cycles) return;  \
+        goto *dispatch[read_memory(cpu, cpu->PC++)];      \
+    } while (0)
+
+    NEXT();
+
+    // One handler per opcode, its addressing mode and operation inlined into straight-line code
+#define OP(code, mode, cycles, operation)                 \
+    op_##code:                                            \
+        operation(cpu, FETCH_##mode);                     \
+        cpu->global_cycles += cycles;                     \
+        NEXT();
+#include "opcodes.def"
+#undef OP
+
+    // Undocumented opcodes are skipped as 1-byte NOPs
+op_illegal:
+    cpu->global_cycles += 2;
+    NEXT();
+
+#undef NEXT
+}
+
+#else
+
+void cpu_run(cpu_t *cpu, u64 target_cycles)
+{
+    cpu->cycle_deadline = target_cycles;
+
+    while (cpu->global_cycles < target_cycles) {
+        cpu_step(cpu);
+    }
+}
+
+#endif
@@ -28,95 +28,634 @@ typedef struct opcode_t
 
 extern opcode_t opcodes[256];
 
-u16 imm_address(cpu_t *cpu);
-u16 zp_address(cpu_t *cpu);
-u16 zpx_address(cpu_t *cpu);
-u16 zpy_address(cpu_t *cpu);
-u16 abs_address(cpu_t *cpu);
-u16 abx_address(cpu_t *cpu);
-u16 aby_address(cpu_t *cpu);
-u16 ind_address(cpu_t *cpu);
-u16 indx_address(cpu_t *cpu);
-u16 indy_address(cpu_t *cpu);
-u16 imp_address(cpu_t *cpu);
-i8 rel_address(cpu_t *cpu);
+// Addressing Modes (inlined into both dispatch engines)
+static inline u16 imm_address(cpu_t *cpu) {
+    return cpu->PC++;
+}
+
+static inline u16 zp_address(cpu_t *cpu) {
+    u8 addr = read_memory(cpu, cpu->PC++);
+    return addr;
+}
+
+static inline u16 zpx_address(cpu_t *cpu) {
+    u8 addr = read_memory(cpu, cpu->PC++);
+    return (addr + cpu->X) & 0xFF;
+}
+
+static inline u16 zpy_address(cpu_t *cpu) {
+    u8 addr = read_memory(cpu, cpu->PC++);
+    return (addr + cpu->Y) & 0xFF;
+}
+
+static inline u16 abs_address(cpu_t *cpu) {
+    u8 lo = read_memory(cpu, cpu->PC++);
+    u8 hi = read_memory(cpu, cpu->PC++);
+    return (hi << 8) | lo;  
+}
+
+static inline u16 abx_address(cpu_t *cpu) {
+    u8 lo = read_memory(cpu, cpu->PC++);
+    u8 hi = read_memory(cpu, cpu->PC++);
+    u16 base = (hi << 8) | lo;
+    return base + cpu->X; 
+}
+
+static inline u16 aby_address(cpu_t *cpu) {
+    u8 lo = read_memory(cpu, cpu->PC++);
+    u8 hi = read_memory(cpu, cpu->PC++);
+    u16 base = (hi << 8) | lo;
+    return base + cpu->Y; 
+}
+
+static inline u16 ind_address(cpu_t *cpu) {
+    u8 ptr_lo = read_memory(cpu, cpu->PC++);
+    u8 ptr_hi = read_memory(cpu, cpu->PC++);
+    u16 ptr = (ptr_hi << 8) | ptr_lo;
+
+    // Emulate 6502 page-boundary bug
+    u8 lo = read_memory(cpu, ptr);
+    u8 hi;
+    if ((ptr & 0x00FF) == 0x00FF) {
+        hi = read_memory(cpu, ptr & 0xFF00); // wraps around page
+    } else {
+        hi = read_memory(cpu, ptr + 1);
+    }
+    return (hi << 8) | lo;
+}
+
+static inline u16 indx_address(cpu_t *cpu) {
+    u8 zp_addr = read_memory(cpu, cpu->PC++);
+    u8 lo = read_memory(cpu, (zp_addr + cpu->X) & 0xFF);
+    u8 hi = read_memory(cpu, (zp_addr + cpu->X + 1) & 0xFF);
+    u16 addr = ((hi << 8) | lo);
+    return addr;
+}
+
+static inline u16 indy_address(cpu_t *cpu) {
+    u8 zp_addr = read_memory(cpu, cpu->PC++);
+    u8 lo = read_memory(cpu, zp_addr);
+    u8 hi = read_memory(cpu, (zp_addr + 1) & 0xFF);
+    u16 addr = ((hi << 8) | lo) + cpu->Y;
+    return addr;
+}
+
+static inline u16 imp_address(cpu_t *cpu) {
+    (void)cpu;
+    return 0;
+}
+
+static inline i8 rel_address(cpu_t *cpu) {
+    return (i8)read_memory(cpu, cpu->PC++);
+}
+
+// Operations are inlined into both dispatch engines, the threaded engine compiles
+// each opcode into straight-line code
 
 // Load/Store
-void LDA(cpu_t *cpu, u16 addr);
-void LDX(cpu_t *cpu, u16 addr);
-void LDY(cpu_t *cpu, u16 addr);
-void STA(cpu_t *cpu, u16 addr);
-void STX(cpu_t *cpu, u16 addr);
-void STY(cpu_t *cpu, u16 addr);
+static inline void LDA(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    cpu->A = value;
+
+    cpu->nz_result = cpu->A;
+}
+
+static inline void LDX(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    cpu->X = value;
+
+    cpu->nz_result = cpu->X;
+}
+
+static inline void LDY(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    cpu->Y = value;
+
+    cpu->nz_result = cpu->Y;
+}
+
+static inline void STA(cpu_t *cpu, u16 addr)
+{
+    write_memory(cpu, addr, cpu->A);
+}
+
+static inline void STX(cpu_t *cpu, u16 addr)
+{
+    write_memory(cpu, addr, cpu->X);
+}
+
+static inline void STY(cpu_t *cpu, u16 addr)
+{
+    write_memory(cpu, addr, cpu->Y);
+}
 
 // Increment/Decrement
-void INC(cpu_t *cpu, u16 addr);
-void INX(cpu_t *cpu, u16 addr);
-void INY(cpu_t *cpu, u16 addr);
-void DEC(cpu_t *cpu, u16 addr);
-void DEX(cpu_t *cpu, u16 addr);
-void DEY(cpu_t *cpu, u16 addr);
+static inline void INC(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    value = (value + 1) & 0xFF;
+    write_memory(cpu, addr, value);
+
+    cpu->nz_result = value;
+}
+
+static inline void INX(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->X = (cpu->X + 1) & 0xFF;
+    cpu->nz_result = cpu->X;
+}
+
+static inline void INY(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->Y = (cpu->Y + 1) & 0xFF;
+    cpu->nz_result = cpu->Y;
+}
+
+static inline void DEC(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    value = (value - 1) & 0xFF;
+    write_memory(cpu, addr, value);
+
+    cpu->nz_result = value;
+}
+
+static inline void DEX(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->X = (cpu->X - 1) & 0xFF;
+    cpu->nz_result = cpu->X;
+}
+
+static inline void DEY(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->Y = (cpu->Y - 1) & 0xFF;
+    cpu->nz_result = cpu->Y;
+}
 
 // Stack
-void PHA(cpu_t *cpu, u16 addr); // Push Accumulator
-void PHP(cpu_t *cpu, u16 addr); // Push Processor Status
-void PLA(cpu_t *cpu, u16 addr); // Pull Accumulator
-void PLP(cpu_t *cpu, u16 addr); // Pull Processor
+
+// Push Accumulator
+static inline void PHA(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    write_memory(cpu, (0x100 | cpu->SP), cpu->A);
+    cpu->SP--;
+}
+
+// Push Processor Status
+static inline void PHP(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    write_memory(cpu, (0x100 | cpu->SP), get_status(cpu));
+    cpu->SP--;
+}
+
+// Pull Accumulator
+static inline void PLA(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->SP++;
+    cpu->A = read_memory(cpu, (0x0100 | cpu->SP));
+    
+    cpu->nz_result = cpu->A;
+}
+
+// Pull Processor
+static inline void PLP(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->SP++;
+    u8 value = read_memory(cpu, (0x100 | cpu->SP));
+
+    set_status(cpu, value);
+}
 
 // Branch
-void BCC(cpu_t *cpu, u16 addr); // Branch on Carry Clear
-void BCS(cpu_t *cpu, u16 addr); // Branch on Carry Set
-void BEQ(cpu_t *cpu, u16 addr); // Branch on Equal
-void BNE(cpu_t *cpu, u16 addr); // Branch on Not Equal
-void BMI(cpu_t *cpu, u16 addr); // Branch on Minus
-void BPL(cpu_t *cpu, u16 addr); // Branch on Plus
-void BVC(cpu_t *cpu, u16 addr); // Branch on Overflow Clear
-void BVS(cpu_t *cpu, u16 addr); // Branch on Overflow Set
+
+// Branch on Carry Clear
+static inline void BCC(cpu_t *cpu, u16 addr)
+{
+    if (!flag_c(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Carry Set
+static inline void BCS(cpu_t *cpu, u16 addr)
+{
+    if (flag_c(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Equal
+static inline void BEQ(cpu_t *cpu, u16 addr)
+{
+    if (flag_z(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Not Equal
+static inline void BNE(cpu_t *cpu, u16 addr)
+{
+    if (!flag_z(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Minus
+static inline void BMI(cpu_t *cpu, u16 addr)
+{
+    if (flag_n(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Plus
+static inline void BPL(cpu_t *cpu, u16 addr)
+{
+    if (!flag_n(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Overflow Clear
+static inline void BVC(cpu_t *cpu, u16 addr)
+{
+    if (!flag_v(cpu)) cpu->PC += (i8)addr;
+}
+
+// Branch on Overflow Set
+static inline void BVS(cpu_t *cpu, u16 addr)
+{
+    if (flag_v(cpu)) cpu->PC += (i8)addr;
+}
+
+// Jump
 
 // Jump
-void JMP(cpu_t *cpu, u16 addr); // Jump
-void JSR(cpu_t *cpu, u16 addr); // Jump to Subroutine
-void RTS(cpu_t *cpu, u16 addr); // Return from Subroutine
-void RTI(cpu_t *cpu, u16 addr); // Return from Interrupt
+static inline void JMP(cpu_t *cpu, u16 addr)
+{
+    cpu->PC = addr;
+}
+
+// Jump to Subroutine
+static inline void JSR(cpu_t *cpu, u16 addr)
+{
+    u16 return_addr = cpu->PC - 1;
+
+    write_memory(cpu, 0x100 | cpu->SP, (return_addr >> 8) & 0xFF); // hi
+    cpu->SP--;
+    write_memory(cpu, 0x100 | cpu->SP, return_addr & 0xFF);        // lo
+    cpu->SP--;
+
+    cpu->PC = addr;
+}
+
+// Return from Subroutine
+static inline void RTS(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->SP++;
+    u8 lo = read_memory(cpu, (0x100 | cpu->SP));
+
+    cpu->SP++;
+    u8 hi = read_memory(cpu, (0x100 | cpu->SP));
+
+    cpu->PC = ((hi << 8) | lo) + 1;
+}
+
+// Return from Interrupt
+static inline void RTI(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    // Resotre Processor Status
+    cpu->SP++;
+    u8 value = read_memory(cpu, (0x100 | cpu->SP));
+
+    set_status(cpu, value);
+    cpu->B = (value & BREAK_FLAG);
+
+    // Low Byte of Return Address
+    cpu->SP++;
+    u8 lo = read_memory(cpu, (0x100 | cpu->SP));
+
+    // High Byte
+    cpu->SP++;
+    u8 hi = read_memory(cpu, (0x100 | cpu->SP));
+
+    cpu->PC = (hi << 8) | lo;
+}
 
 // Transfer
-void TAX(cpu_t *cpu, u16 addr); // Transfer Accumulator to X
-void TAY(cpu_t *cpu, u16 addr); // Transfer Accumulator to Y
-void TXA(cpu_t *cpu, u16 addr); // Transfer X to Accumulator
-void TYA(cpu_t *cpu, u16 addr); // Transfer Y to Accumulator
-void TSX(cpu_t *cpu, u16 addr); // Transfer Stack Pointer to X
-void TXS(cpu_t *cpu, u16 addr); // Transfer X to Stack Pointer
+
+// Transfer Accumulator to X
+static inline void TAX(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->X = cpu->A;
+
+    cpu->nz_result = cpu->X;
+}
+
+// Transfer Accumulator to Y
+static inline void TAY(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->Y = cpu->A;
+    
+    cpu->nz_result = cpu->Y;
+}
+
+// Transfer X to Accumulator
+static inline void TXA(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->A = cpu->X;
+    
+    cpu->nz_result = cpu->A;
+}
+
+// Transfer Y to Accumulator
+static inline void TYA(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->A = cpu->Y;
+    
+    cpu->nz_result = cpu->A;
+}
+
+// Transfer Stack Pointer to X
+static inline void TSX(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->X = cpu->SP;
+    cpu->nz_result = cpu->X;
+}
+
+// Transfer X to Stack Pointer
+static inline void TXS(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->SP = cpu->X;
+}
 
 // Arithmetic & Logic
-void ADC(cpu_t *cpu, u16 addr);
-void SBC(cpu_t *cpu, u16 addr);
-void AND(cpu_t *cpu, u16 addr);
-void EOR(cpu_t *cpu, u16 addr);
-void ORA(cpu_t *cpu, u16 addr);
-void CMP(cpu_t *cpu, u16 addr);
-void CPX(cpu_t *cpu, u16 addr);
-void CPY(cpu_t *cpu, u16 addr);
+static inline void ADC(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u8 carry = flag_c(cpu);
+    u16 result = cpu->A + value + carry;
+
+    if (cpu->D) {
+        u16 tmp = (cpu->A & 0x0F) + (value & 0x0F) + carry;
+
+        if (tmp > 9) {
+            result += 6;
+        }
+        if (result > 0x99) {
+            result += 0x60;
+        }
+    }
+
+    cpu->c_result = result;
+    cpu->v_result = (cpu->A ^ result) & (value ^ result);
+
+    cpu->A = result & 0xFF;
+
+    cpu->nz_result = cpu->A;
+}
+
+static inline void SBC(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u16 result = cpu->A - value - (1 - flag_c(cpu));
+
+    // A + ~value + C carries out exactly when no borrow occurred
+    cpu->c_result = cpu->A + (u8)~value + flag_c(cpu);
+    cpu->v_result = (cpu->A ^ result) & (~value ^ result);
+
+
+    if (cpu->D) {
+        // Decimal mode adjustment
+        u16 tmp = result;
+
+        // Low nibble adjust
+        if (((cpu->A & 0x0F) - (1 - flag_c(cpu))) < (value & 0x0F)) {
+            tmp -= 0x06;
+        }
+
+        // High nibble adjust
+        if (tmp > 0x99) {
+            tmp -= 0x60;
+        }
+
+        result = tmp;
+    }
+
+    cpu->A = result & 0xFF;
+
+    cpu->nz_result = cpu->A;
+}
+
+static inline void AND(cpu_t *cpu, u16 addr)
+{
+    cpu->A &= read_memory(cpu, addr);
+    cpu->nz_result = cpu->A;
+}
+
+static inline void EOR(cpu_t *cpu, u16 addr)
+{
+    cpu->A ^= read_memory(cpu, addr);
+    cpu->nz_result = cpu->A;
+}
+
+static inline void ORA(cpu_t *cpu, u16 addr)
+{
+    cpu->A |= read_memory(cpu, addr);
+    cpu->nz_result = cpu->A;
+}
+
+static inline void CMP(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u8 result = cpu->A - value;
+    cpu->c_result = cpu->A + (u8)~value + 1;
+    cpu->nz_result = result;
+}
+
+static inline void CPX(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u8 result = cpu->X - value;
+    cpu->c_result = cpu->X + (u8)~value + 1;
+    cpu->nz_result = result;
+}
+
+static inline void CPY(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u8 result = cpu->Y - value;
+    cpu->c_result = cpu->Y + (u8)~value + 1;
+    cpu->nz_result = result;
+}
 
 // Shift and Rotate Operations
-void ASL_ACC(cpu_t *cpu, u16 addr);
-void ASL(cpu_t *cpu, u16 addr);
-void LSR_ACC(cpu_t *cpu, u16 addr);
-void LSR(cpu_t *cpu, u16 addr);
-void ROL_ACC(cpu_t *cpu, u16 addr);
-void ROL(cpu_t *cpu, u16 addr);
-void ROR_ACC(cpu_t *cpu, u16 addr);
-void ROR(cpu_t *cpu, u16 addr);
-
-void SEC(cpu_t *cpu, u16 addr); // Set Carry Flag
-void SED(cpu_t *cpu, u16 addr); // Set Decimal Flag
-void SEI(cpu_t *cpu, u16 addr); // Set Interrupt Disable
-void CLC(cpu_t *cpu, u16 addr); // Clear Carry Flag
-void CLD(cpu_t *cpu, u16 addr); // Clear Decimal Flag
-void CLI(cpu_t *cpu, u16 addr); // Clear Interrupt Disable
-void CLV(cpu_t *cpu, u16 addr); // Clear Overflow Flag
-
-void BIT(cpu_t *cpu, u16 addr);
-void BRK(cpu_t *cpu, u16 addr);
-void NOP(cpu_t *cpu, u16 addr);
+static inline void ASL_ACC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->c_result = cpu->A << 1;
+    cpu->A <<= 1;
+    cpu->nz_result = cpu->A;
+}
+
+static inline void ASL(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    cpu->c_result = value << 1;
+    value <<= 1;
+    cpu->nz_result = value;
+
+    write_memory(cpu, addr, value);
+}
+
+static inline void LSR_ACC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->c_result = (cpu->A & CARRY_FLAG) << 8;
+    cpu->A >>= 1;
+    cpu->nz_result = cpu->A;
+}
+
+static inline void LSR(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    cpu->c_result = (value & CARRY_FLAG) << 8;
+    value >>= 1;
+    cpu->nz_result = value;
+    write_memory(cpu, addr, value);
+}
+
+static inline void ROL_ACC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    u8 old_c = flag_c(cpu);
+    cpu->c_result = cpu->A << 1;
+    cpu->A = (cpu->A << 1) | old_c;
+    cpu->nz_result = cpu->A;
+}
+
+static inline void ROL(cpu_t *cpu, u16 addr)
+{
+    u8 old_c = flag_c(cpu);
+    u8 value = read_memory(cpu, addr);
+    cpu->c_result = value << 1;
+    value = (value << 1) | old_c;       
+    cpu->nz_result = value;
+
+    write_memory(cpu, addr, value);
+}
+
+static inline void ROR_ACC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    u8 old_c = flag_c(cpu);
+    cpu->c_result = (cpu->A & CARRY_FLAG) << 8;
+    cpu->A = (cpu->A >> 1) | (old_c << 7);
+    cpu->nz_result = cpu->A;
+}
+
+static inline void ROR(cpu_t *cpu, u16 addr)
+{
+    u8 old_c = flag_c(cpu);
+    u8 value = read_memory(cpu, addr);
+    cpu->c_result = (value & CARRY_FLAG) << 8;
+    value = (value >> 1) | (old_c << 7);
+    cpu->nz_result = value;
+    write_memory(cpu, addr, value);
+}
+
+// Flags
+
+// Set Carry Flag
+static inline void SEC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    set_flag_c(cpu, 1);
+}
+
+// Set Decimal Flag
+static inline void SED(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->D = 1;
+}
+
+// Set Interrupt Disable
+static inline void SEI(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->I = 1;
+}
+
+// Clear Carry Flag
+static inline void CLC(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    set_flag_c(cpu, 0);
+}
+
+// Clear Decimal Flag
+static inline void CLD(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->D = 0;
+}
+
+// Clear Interrupt Disable
+static inline void CLI(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->I = 0;
+}
+
+// Clear Overflow Flag
+static inline void CLV(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->v_result = 0;
+}
+
+// Misc
+static inline void BIT(cpu_t *cpu, u16 addr)
+{
+    u8 value = read_memory(cpu, addr);
+    u8 result = cpu->A & value;
+
+    // Z comes from A & value, N and V straight from bits 7 and 6 of memory
+    cpu->nz_result = result | ((value & NEGATIVE_FLAG) << 1);
+    cpu->v_result = value << 1;
+}
+
+static inline void BRK(cpu_t *cpu, u16 addr)
+{
+    (void)addr;
+    cpu->I = 1;
+
+    u16 return_addr = cpu->PC + 1;
+
+    write_memory(cpu, 0x100 | cpu->SP, (return_addr >> 8) & 0xFF); 
+    cpu->SP--;
+
+    write_memory(cpu, 0x100 | cpu->SP, return_addr & 0xFF);        
+    cpu->SP--;
+
+    write_memory(cpu, (0x100 | cpu->SP), get_status(cpu));
+    cpu->SP--;
+
+    cpu->PC = (read_memory(cpu, BRK_LOW_ADDR)) | (read_memory(cpu, BRK_HIGH_ADDR) << 8);
+}
+
+static inline void NOP(cpu_t *cpu, u16 addr)
+{
+    (void)cpu;
+    (void)addr;
+}
 
 #endif
\ No newline at end of file
@@ -1,76 +1,587 @@
 #include "disk.h"
+#include "woz.h"
 #include "utils/tinyfiledialogs.h"
 
-disk_t load_disk()
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// 6-bit values to valid disk nibbles
+static const u8 write_table[64] = {
+    0x96, 0x97, 0x9A, 0x9B, 0x9D, 0x9E, 0x9F, 0xA6, 0xA7, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF, 0xB2, 0xB3,
+    0xB4, 0xB5, 0xB6, 0xB7, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF, 0xCB, 0xCD, 0xCE, 0xCF, 0xD3,
+    0xD6, 0xD7, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF, 0xE5, 0xE6, 0xE7, 0xE9, 0xEA, 0xEB, 0xEC,
+    0xED, 0xEE, 0xEF, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+};
+
+// Physical sector -> DOS 3.3 logical sector as stored in a .dsk
+static const u8 dos_order[SECTORS] = {
+    0x0, 0x7, 0xE, 0x6, 0xD, 0x5, 0xC, 0x4, 0xB, 0x3, 0xA, 0x2, 0x9, 0x1, 0x8, 0xF
+};
+
+// Sync bytes before the first sector, between the fields, and after each sector
+#define GAP1 48
+#define GAP2 6
+#define GAP3 27
+
+// IEEE CRC-32, the identity save states check a mounted image against
+static u32 crc32(const u8 *data, size_t size)
+{
+    static u32 table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (u32 i = 0; i < 256; i++) {
+            u32 crc = i;
+            for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0);
+            table[i] = crc;
+        }
+        ready = true;
+    }
+
+    u32 crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+    return ~crc;
+}
+
+// Map the whole file. A .dsk is mapped twice: the drive works on a private copy-on-write
+// view, so sectors a save state puts back never reach the file, and only sectors DOS
+// writes are copied through to the shared mapping. NIB tracks are written in place.
+// Read-only files, and formats never written back, have no shared mapping and mount
+// write protected.
+static bool map_image(disk_t *disk, const char *disk_path, bool writable)
+{
+    int fd = writable ? open(disk_path, O_RDWR) : -1;
+    if (fd < 0 && (!writable || errno == EACCES || errno == EROFS)) {
+        fd = open(disk_path, O_RDONLY);
+        disk->write_protect = true;
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open disk image %s\n", disk_path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        fprintf(stderr, "Error: Disk image %s is empty\n", disk_path);
+        close(fd);
+        return false;
+    }
+
+    bool overlay = disk->write_protect || disk->format == DSK;
+    void *image = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, overlay ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    void *file = image;
+    if (image != MAP_FAILED && overlay && !disk->write_protect) {
+        file = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (file == MAP_FAILED) munmap(image, st.st_size);
+    }
+    close(fd);
+    if (image == MAP_FAILED || file == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map disk image %s\n", disk_path);
+        return false;
+    }
+
+    disk->image = image;
+    disk->file = disk->write_protect ? NULL : file;
+    disk->image_size = st.st_size;
+    return true;
+}
+
+// Mount an image, or ask for one when disk_path is NULL. The file is mapped rather
+// than read, so mounting costs one pass for the image CRC and DOS writes land straight
+// in the file.
+bool load_disk(disk_t *disk, const char *disk_path)
 {
     // Init Blank Disk
-    disk_t disk = {0};
+    unload_disk(disk);
 
     // Choose Rom
-    const char *filters[] = { "*.dsk", "*.nib", "*.woz" };
-    const char *disk_path = tinyfd_openFileDialog("Load Disk", "", 1, filters, "Choose Disk Image", 0);
+    if (disk_path == NULL) {
+        const char *filters[] = { "*.dsk", "*.nib", "*.woz" };
+        disk_path = tinyfd_openFileDialog("Load Disk", "", 1, filters, "Choose Disk Image", 0);
+    }
     if (disk_path == NULL) {
         fprintf(stderr, "Error: No image selected or invalid path\n");
-        disk.loaded = false;
-        return disk;
+        return false;
     }
 
     // Check File Extension, set format based on it
     const char *ext = strrchr(disk_path, '.');
-    if (ext && strcmp(ext, "dsk") == 0) disk.format = DSK;
-    else if (ext && strcmp(ext, "nib") == 0) disk.format = NIB;
-    else if (ext && strcmp(ext, "woz") == 0) disk.format = WOZ;
+    if (ext && strcasecmp(ext, ".dsk") == 0) disk->format = DSK;
+    else if (ext && strcasecmp(ext, ".nib") == 0) disk->format = NIB;
+    else if (ext && strcasecmp(ext, ".woz") == 0) disk->format = WOZ;
 
-    FILE *f = fopen(disk_path, "rb");
-    if (!f) {
-        fprintf(stderr, "Error: Could not open disk image %s\n", disk_path);
-        disk.loaded = false;
-        return disk;
+    if (!map_image(disk, disk_path, disk->format != WOZ)) return false;
+
+    bool ok = true;
+    switch (disk->format) {
+        case DSK:
+            ok = disk->image_size == DSK_SIZE;
+            if (!ok) {
+                fprintf(stderr, "Error: Disk image wrong size (got %zu, expected %d)\n",
+                        disk->image_size, DSK_SIZE);
+            }
+            disk->dsk_data = (void *)disk->image;
+            disk->nibbles = malloc(TRACKS * TRACK_NIBBLES);
+            disk->original = malloc(DSK_SIZE);
+            if (ok && (!disk->nibbles || !disk->original)) {
+                fprintf(stderr, "Error: Could not allocate the track cache\n");
+                ok = false;
+            }
+            break;
+        // Already nibblized, the read head indexes the file directly
+        case NIB:
+            ok = disk->image_size == NIB_SIZE;
+            if (!ok) {
+                fprintf(stderr, "Error: Disk image wrong size (got %zu, expected %d)\n",
+                        disk->image_size, NIB_SIZE);
+            }
+            disk->nib_data = (void *)disk->image;
+            break;
+        case WOZ:
+            ok = woz_load(disk);
+            break;
+    }
+
+    if (!ok) {
+        unload_disk(disk);
+        return false;
+    }
+
+    disk->image_crc = crc32(disk->image, disk->image_size);
+    disk->loaded = true;
+    return true;
+}
+
+// Hand the tracks written since the last flush to the OS. msync wants whole pages,
+// so each track's range is widened to the pages around it.
+static bool sync_tracks(disk_t *disk, int flags)
+{
+    if (!disk->file) {
+        disk->unflushed = 0;
+        return true;
     }
 
-    size_t bytes_read = fread(disk.dsk_data, 1, TRACKS * SECTORS * BYTES, f);
-    fclose(f);
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    size_t track_size = disk->format == NIB ? TRACK_NIBBLES : TRACK_BYTES;
+    bool ok = true;
+
+    while (disk->unflushed) {
+        int track = __builtin_ctzll(disk->unflushed);
+        disk->unflushed &= disk->unflushed - 1;
+
+        uintptr_t data = (uintptr_t)disk->file + track * track_size;
+        uintptr_t start = data & ~(page - 1);
+        uintptr_t end = data + track_size;
+        if (msync((void *)start, end - start, flags) != 0) ok = false;
+    }
+
+    if (!ok) fprintf(stderr, "Error: Could not write back disk image\n");
+    return ok;
+}
+
+// Block until every written sector is in the image file
+bool save_disk(disk_t *disk)
+{
+    return sync_tracks(disk, MS_SYNC);
+}
+
+// Schedule written sectors for write-back without waiting on the disk
+void flush_disk(disk_t *disk)
+{
+    if (disk->unflushed) sync_tracks(disk, MS_ASYNC);
+}
+
+// Write back and unmap, leaving an empty drive
+void unload_disk(disk_t *disk)
+{
+    if (disk->image) {
+        save_disk(disk);
+        if (disk->file && disk->file != disk->image) munmap(disk->file, disk->image_size);
+        munmap(disk->image, disk->image_size);
+    }
+    free(disk->nibbles);
+    free(disk->original);
+    free(disk->woz_tracks);
+    memset(disk, 0, sizeof(*disk));
+}
+
+// DOS wrote a sector into the private view, keep it in save states and copy it through
+// to the file for the next flush
+void mark_sector(disk_t *disk, int track, int sector)
+{
+    disk->dirty_sectors[track] |= 1u << sector;
+    if (!disk->file) return;
+
+    if (disk->file != disk->image) {
+        size_t offset = (track * SECTORS + sector) * BYTES;
+        if (!(disk->kept_sectors[track] & (1u << sector))) {
+            memcpy(disk->original[track][sector], disk->file + offset, BYTES);
+            disk->kept_sectors[track] |= 1u << sector;
+        }
+        memcpy(disk->file + offset, disk->image + offset, BYTES);
+    }
+    disk->unflushed |= 1ull << track;
+}
+
+// Put a .dsk sector back the way a save state saw it, or as mounted when data is NULL.
+// Only the private view changes, the file keeps what DOS last wrote.
+void restore_sector(disk_t *disk, int track, int sector, const u8 *data)
+{
+    // A sector not kept yet was never changed, the view still holds it as mounted
+    if (!(disk->kept_sectors[track] & (1u << sector))) {
+        memcpy(disk->original[track][sector], disk->dsk_data[track][sector], BYTES);
+        disk->kept_sectors[track] |= 1u << sector;
+    }
+
+    memcpy(disk->dsk_data[track][sector], data ? data : disk->original[track][sector], BYTES);
+    invalidate_track(disk, track);
+}
+
+// 4-and-4 encoding used by address fields: odd bits, then even bits
+static u8 *write_44(u8 *out, u8 value)
+{
+    *out++ = (value >> 1) | 0xAA;
+    *out++ = value | 0xAA;
+    return out;
+}
+
+// 6-and-2 encode one sector's data field body: 86 nibbles of paired low bits, 256 of
+// high bits, each XORed with the previous value, then the checksum
+static u8 *write_62(u8 *out, const u8 data[BYTES])
+{
+    u8 values[342] = {0};
+
+    for (int i = 0; i < BYTES; i++) {
+        // Low two bits go in swapped, three bytes share each of the first 86 values
+        u8 low = ((data[i] & 1) << 1) | ((data[i] >> 1) & 1);
+        values[i % 86] |= low << (2 * (i / 86));
+        values[86 + i] = data[i] >> 2;
+    }
+
+    u8 last = 0;
+    for (int i = 0; i < 342; i++) {
+        *out++ = write_table[values[i] ^ last];
+        last = values[i];
+    }
+    *out++ = write_table[last];
+
+    return out;
+}
+
+static u8 *write_sync(u8 *out, int count)
+{
+    memset(out, 0xFF, count);
+    return out + count;
+}
+
+// Nibblize a whole track the first time it is needed, later reads index the cache
+const u8 *encode_track(disk_t *disk, int track)
+{
+    u8 *nibbles = disk->nibbles[track];
+    if (disk->nibbles_valid & (1ull << track)) return nibbles;
+
+    u8 *out = write_sync(nibbles, GAP1);
 
-    if (bytes_read != TRACKS * SECTORS * BYTES) {
-        fprintf(stderr, "Error: Disk image wrong size (got %zu, expected %d)\n",
-                bytes_read, TRACKS * SECTORS * BYTES);
-        disk.loaded = false;
-        return disk;
+    for (int sector = 0; sector < SECTORS; sector++) {
+        // Address Field
+        *out++ = 0xD5; *out++ = 0xAA; *out++ = 0x96;
+        out = write_44(out, DISK_VOLUME);
+        out = write_44(out, track);
+        out = write_44(out, sector);
+        out = write_44(out, DISK_VOLUME ^ track ^ sector);
+        *out++ = 0xDE; *out++ = 0xAA; *out++ = 0xEB;
+        out = write_sync(out, GAP2);
+
+        // Data Field
+        *out++ = 0xD5; *out++ = 0xAA; *out++ = 0xAD;
+        out = write_62(out, disk->dsk_data[track][dos_order[sector]]);
+        *out++ = 0xDE; *out++ = 0xAA; *out++ = 0xEB;
+        out = write_sync(out, GAP3);
     }
 
-    disk.current_track = 0;
-    disk.current_sector = 0;
-    disk.current_byte = 0;
-    disk.loaded = true;
-    disk.write_mode = false;
-    
-    return disk;
+    // Pad the rest of the revolution with sync bytes
+    write_sync(out, nibbles + TRACK_NIBBLES - out);
+
+    disk->nibbles_valid |= 1ull << track;
+    return nibbles;
+}
+
+// Sector data changed underneath the cache, re-encode on the next read
+void invalidate_track(disk_t *disk, int track)
+{
+    disk->nibbles_valid &= ~(1ull << track);
+}
+
+// Decode one nibble of a 4-and-4 pair at pos
+static u8 read_44(const u8 *nibbles, int pos)
+{
+    return ((nibbles[pos % TRACK_NIBBLES] << 1) | 1) & nibbles[(pos + 1) % TRACK_NIBBLES];
+}
+
+static bool match_prologue(const u8 *nibbles, int pos, u8 third)
+{
+    return nibbles[pos % TRACK_NIBBLES] == 0xD5 && nibbles[(pos + 1) % TRACK_NIBBLES] == 0xAA
+        && nibbles[(pos + 2) % TRACK_NIBBLES] == third;
 }
 
-bool save_disk(disk_t *disk, const char* disk_path)
+// Decode a 6-and-2 data field body at pos, false if a nibble or the checksum is bad
+static bool read_62(const u8 *nibbles, int pos, u8 data[BYTES])
 {
+    static u8 read_table[256];
+    static bool ready = false;
+    if (!ready) {
+        memset(read_table, 0xFF, sizeof(read_table));
+        for (int i = 0; i < 64; i++) read_table[write_table[i]] = i;
+        ready = true;
+    }
+
+    u8 values[343];
+    u8 last = 0;
+    for (int i = 0; i < 343; i++) {
+        u8 value = read_table[nibbles[(pos + i) % TRACK_NIBBLES]];
+        if (value == 0xFF) return false;
+        last ^= value;
+        values[i] = last;
+    }
+    if (values[342] != 0) return false;
+
+    for (int i = 0; i < BYTES; i++) {
+        u8 low = (values[i % 86] >> (2 * (i / 86))) & 3;
+        data[i] = (values[86 + i] << 2) | ((low & 1) << 1) | (low >> 1);
+    }
     return true;
 }
 
+// Bring sectors written through the controller back into dsk_data
+static void decode_track(disk_t *disk, int track)
+{
+    const u8 *nibbles = disk->nibbles[track];
+    u8 data[BYTES];
+
+    for (int pos = 0; pos < TRACK_NIBBLES; pos++) {
+        if (!match_prologue(nibbles, pos, 0x96)) continue;
+        if (read_44(nibbles, pos + 5) != track) continue;
+        u8 sector = read_44(nibbles, pos + 7);
+        if (sector >= SECTORS) continue;
+
+        // The data field follows within a few sync bytes of the address field
+        for (int gap = 14; gap < 64; gap++) {
+            if (!match_prologue(nibbles, pos + gap, 0xAD)) continue;
+
+            u8 *stored = disk->dsk_data[track][dos_order[sector]];
+            if (read_62(nibbles, pos + gap + 3, data) && memcmp(stored, data, BYTES) != 0) {
+                memcpy(stored, data, BYTES);
+                mark_sector(disk, track, dos_order[sector]);
+            }
+            break;
+        }
+    }
+
+    disk->track_written = false;
+}
+
+// Let the disk turn under the head for the cycles since the last access
+static void spin(disk_controller_t *ctrl, disk_t *disk, u64 cycles)
+{
+    // Writes move the head themselves, one nibble per byte the CPU stores
+    if (!ctrl->motor_on || ctrl->q7) {
+        disk->spin_cycles = cycles;
+        return;
+    }
+
+    if (disk->format == WOZ) {
+        woz_spin(disk, cycles);
+        return;
+    }
+
+    u64 nibbles = (cycles - disk->spin_cycles) / CYCLES_PER_NIBBLE;
+    if (!nibbles) return;
+
+    disk->head_pos = (disk->head_pos + nibbles) % TRACK_NIBBLES;
+    disk->spin_cycles += nibbles * CYCLES_PER_NIBBLE;
+    disk->nibble_read = false;
+}
+
+// The nibble under the head, with bit 7 set only the first time it is read so a
+// polling loop sees each nibble once
 u8 read_disk_register(disk_t *disk)
 {
     u8 byte = 0;
 
     switch (disk->format) {
         case DSK:
+            byte = encode_track(disk, disk->current_track)[disk->head_pos];
             break;
         case NIB:
+            byte = disk->nib_data[disk->current_track][disk->head_pos];
             break;
         case WOZ:
+            byte = disk->nibble;
             break;
     }
 
-    disk->current_byte++;
-    if (disk->current_byte == BYTES - 1)
-    {
-        disk->current_byte = 0;
-        disk->current_sector = (disk->current_sector + 1) % SECTORS;
+    if (disk->nibble_read) return byte & 0x7F;
+    disk->nibble_read = true;
+    return byte;
+}
+
+// Write the data latch after the nibble under the head, writes are paced by the CPU
+static void write_nibble(disk_t *disk, u8 value, u64 cycles)
+{
+    if (disk->write_protect || disk->format == WOZ) return;
+
+    // NIB tracks are the file itself, .dsk writes go to the cache and are decoded later
+    u8 *nibbles;
+    if (disk->format == NIB) {
+        nibbles = disk->nib_data[disk->current_track];
+        disk->unflushed |= 1ull << disk->current_track;
+    } else {
+        encode_track(disk, disk->current_track);
+        nibbles = disk->nibbles[disk->current_track];
+        disk->track_written = true;
     }
 
-    return byte;
-}
\ No newline at end of file
+    disk->head_pos = (disk->head_pos + 1) % TRACK_NIBBLES;
+    nibbles[disk->head_pos] = value;
+    disk->spin_cycles = cycles;
+    disk->nibble_read = true;
+}
+
+// Energizing the magnet next to the current one pulls the head half a track that way
+static void step(disk_t *disk, int phase)
+{
+    int delta = (phase - disk->phase) & 3;
+    int half_track = disk->half_track;
+
+    if (delta == 1) half_track++;
+    else if (delta == 3) half_track--;
+    disk->phase = phase;
+
+    if (half_track < 0) half_track = 0;
+    if (half_track > MAX_HALF_TRACK) half_track = MAX_HALF_TRACK;
+    if (half_track / 2 != disk->current_track && disk->track_written) decode_track(disk, disk->current_track);
+
+    int old_half_track = disk->half_track;
+    disk->half_track = half_track;
+    disk->current_track = half_track / 2;
+    if (disk->format == WOZ) woz_move_head(disk, old_half_track);
+}
+
+// Controller with two empty drives, NULL if out of memory
+disk_controller_t *disk_controller_create(void)
+{
+    disk_controller_t *ctrl = calloc(1, sizeof(*ctrl));
+    if (!ctrl) return NULL;
+
+    ctrl->drives[0] = calloc(1, sizeof(disk_t));
+    ctrl->drives[1] = calloc(1, sizeof(disk_t));
+    if (!ctrl->drives[0] || !ctrl->drives[1]) {
+        disk_controller_destroy(ctrl);
+        return NULL;
+    }
+
+    return ctrl;
+}
+
+// Write back and unmount both drives
+void disk_controller_destroy(disk_controller_t *ctrl)
+{
+    if (!ctrl) return;
+
+    for (int drive = 0; drive < 2; drive++) {
+        if (ctrl->drives[drive]) unload_disk(ctrl->drives[drive]);
+        free(ctrl->drives[drive]);
+    }
+    free(ctrl);
+}
+
+// Soft switches shared by reads and writes ($C0E0-$C0EF)
+static void switch_access(disk_controller_t *ctrl, u16 address, u64 cycles)
+{
+    disk_t *disk = ctrl->drives[ctrl->selected];
+    spin(ctrl, disk, cycles);
+
+    u8 reg = address & 0x0F;
+    switch (reg) {
+        // Stepper Phases 0-3 Off/On
+        case 0x0: case 0x1: case 0x2: case 0x3:
+        case 0x4: case 0x5: case 0x6: case 0x7: {
+            u8 phase = reg >> 1;
+            if (reg & 1) {
+                ctrl->phases |= 1 << phase;
+                if (ctrl->motor_on) step(disk, phase);
+            } else {
+                ctrl->phases &= ~(1 << phase);
+            }
+            break;
+        }
+        // Motor Off/On
+        case 0x8:
+            if (disk->track_written) decode_track(disk, disk->current_track);
+            flush_disk(disk);
+            ctrl->motor_on = false;
+            break;
+        case 0x9:
+            ctrl->motor_on = true;
+            break;
+        // Drive 1/2 Select
+        case 0xA:
+        case 0xB:
+            if (disk->track_written) decode_track(disk, disk->current_track);
+            ctrl->selected = reg & 1;
+            ctrl->drives[ctrl->selected]->spin_cycles = cycles;
+            break;
+        // Q6 Shift/Load
+        case 0xC:
+            ctrl->q6 = false;
+            break;
+        case 0xD:
+            ctrl->q6 = true;
+            break;
+        // Q7 Read/Write Mode
+        case 0xE:
+            if (disk->track_written) decode_track(disk, disk->current_track);
+            ctrl->q7 = false;
+            break;
+        case 0xF:
+            ctrl->q7 = true;
+            break;
+    }
+}
+
+u8 disk_controller_read(disk_controller_t *ctrl, u16 address, u64 cycles)
+{
+    switch_access(ctrl, address, cycles);
+    disk_t *disk = ctrl->drives[ctrl->selected];
+
+    // Only even addresses put the data latch on the bus
+    if (address & 1 || ctrl->q7 || !disk->loaded || !ctrl->motor_on) return 0;
+
+    // Q6 high in read mode senses write protect on bit 7
+    if (ctrl->q6) return disk->write_protect ? 0x80 : 0x00;
+
+    // Accelerated: the next nibble is already under the head instead of 32 cycles away
+    if (ctrl->fast && disk->nibble_read && disk->format == WOZ) {
+        woz_next_nibble(disk, cycles);
+    } else if (ctrl->fast && disk->nibble_read) {
+        disk->head_pos = (disk->head_pos + 1) % TRACK_NIBBLES;
+        disk->spin_cycles = cycles;
+        disk->nibble_read = false;
+    }
+
+    return read_disk_register(disk);
+}
+
+void disk_controller_write(disk_controller_t *ctrl, u16 address, u8 value, u64 cycles)
+{
+    switch_access(ctrl, address, cycles);
+    disk_t *disk = ctrl->drives[ctrl->selected];
+
+    // Load mode in write mode takes the byte on the bus and shifts it onto the disk
+    if (ctrl->q6 && ctrl->q7 && ctrl->motor_on && disk->loaded) {
+        ctrl->latch = value;
+        write_nibble(disk, value, cycles);
+    }
+}
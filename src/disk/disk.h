@@ -6,6 +6,25 @@
 #define TRACKS 35
 #define SECTORS 16
 #define BYTES 256
+#define TRACK_BYTES (SECTORS * BYTES)
+#define DSK_SIZE (TRACKS * TRACK_BYTES)
+
+// Nibblized Track Defines
+#define TRACK_NIBBLES 6656   // Same length as a .nib image track
+#define DISK_VOLUME 254      // Volume number written into every address field
+#define NIB_SIZE (TRACKS * TRACK_NIBBLES)
+
+// Disk II Controller Defines (slot 6)
+#define DISK_IO_START 0xC0E0
+#define DISK_IO_END 0xC0EF
+#define DISK_ROM_ADDR 0xC600
+#define CYCLES_PER_NIBBLE 32         // 8 bits at 4 us each
+#define MAX_HALF_TRACK ((TRACKS - 1) * 2)
+
+// WOZ Defines
+#define WOZ_QUARTER_TRACKS 160
+#define WOZ_NO_TRACK 0xFF            // TMAP entry for an unformatted quarter track
+#define WOZ_BIT_TIMING 32            // 4 us per bit, in 125 ns units
 
 enum DISK_EXT
 {
@@ -14,21 +33,84 @@ enum DISK_EXT
     WOZ
 };
 
+// One WOZ track's bit stream inside the mapped file
+typedef struct
+{
+    u32 offset;
+    u32 bit_count;
+} woz_track_t;
+
+// A drive's hot head state comes first, images and caches live out of line
 typedef struct
 {
-    u8 dsk_data[TRACKS][SECTORS][BYTES]; // Raw Sector Data
+    // Head
     u8 current_track;
-    u8 current_sector;
-    u8 current_byte;
+    u8 half_track;                       // Stepper position (0-68)
+    u8 phase;                            // Magnet the head last settled on
     u8 format;
+    u16 head_pos;                        // Nibble under the read head
+    bool nibble_read;                    // The nibble under the head was already returned
+    bool track_written;                  // Nibbles written since the track was last decoded
+    u64 spin_cycles;                     // global_cycles head_pos was last advanced to
     bool loaded;
-    bool write_mode;
+    bool write_protect;
+
+    // WOZ read head, bits go through the shift register as the disk turns
+    u8 bit_timing;                       // 125 ns units per bit
+    u8 bit_remainder;                    // 125 ns units since the last whole bit
+    u8 shift;                            // Bits assembled toward the next nibble
+    u8 nibble;                           // Last complete nibble, the data latch
+    u8 zero_run;                         // Zero bits in a row, more than 3 read as noise
+    u32 bit_pos;                         // Bit under the read head
+
+    u8 *image;                           // Private copy-on-write view of the file, what the head reads
+    u8 *file;                            // Shared mapping only DOS writes reach, NULL if write protected
+    size_t image_size;
+    u32 image_crc;                       // CRC-32 of the file as mounted, ties save states to it
+    u8 (*dsk_data)[SECTORS][BYTES];      // Raw Sector Data, in the private view
+    u8 (*nib_data)[TRACK_NIBBLES];       // NIB tracks, read and written in place
+
+    // 6-and-2 encoded tracks for a .dsk, built the first time the head reads them
+    u8 (*nibbles)[TRACK_NIBBLES];
+    u64 nibbles_valid;                   // One bit per track
+
+    u64 unflushed;                       // Tracks written since the last flush, one bit each
+    u16 dirty_sectors[TRACKS];           // Sectors written since the image was mounted
+
+    // Sectors as mounted, kept before their first change so a save state can roll them back
+    u8 (*original)[SECTORS][BYTES];
+    u16 kept_sectors[TRACKS];
+
+    // WOZ bit streams
+    woz_track_t *woz_tracks;             // WOZ_QUARTER_TRACKS entries
+    u8 woz_tmap[WOZ_QUARTER_TRACKS];     // Quarter track -> woz_tracks index
 } disk_t;
 
-disk_t load_disk();
-bool save_disk(disk_t *disk, const char* disk_path);
+typedef struct
+{
+    disk_t *drives[2];
+    u8 selected;
+    u8 phases;      // Stepper magnets currently on, one bit each
+    bool motor_on;
+    bool q6;        // Shift / Load
+    bool q7;        // Read / Write
+    u8 latch;       // Last byte written to the disk
+    bool fast;      // Skip the wait for the next nibble to come round
+} disk_controller_t;
+
+bool load_disk(disk_t *disk, const char *disk_path);
+bool save_disk(disk_t *disk);
+void flush_disk(disk_t *disk);
+void unload_disk(disk_t *disk);
+void mark_sector(disk_t *disk, int track, int sector);
+void restore_sector(disk_t *disk, int track, int sector, const u8 *data);
 u8 read_disk_register(disk_t *disk);
-u8 decode_62(u8 data[TRACKS][SECTORS][BYTES]);
+disk_controller_t *disk_controller_create(void);
+void disk_controller_destroy(disk_controller_t *ctrl);
+u8 disk_controller_read(disk_controller_t *ctrl, u16 address, u64 cycles);
+void disk_controller_write(disk_controller_t *ctrl, u16 address, u8 value, u64 cycles);
+void invalidate_track(disk_t *disk, int track);
+const u8 *encode_track(disk_t *disk, int track);
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,82 @@
+#include "rwts.h"
+
+// First instructions of RWTS: STY $48, STA $49 (the IOB pointer)
+static const u8 rwts_signature[] = { 0x84, 0x48, 0x85, 0x49 };
+
+// Run a seek, read or write straight against the image, false to leave it to the real RWTS
+static bool run_rwts(cpu_t *cpu)
+{
+    u16 iob = (cpu->A << 8) | cpu->Y;
+    u8 *memory = cpu->memory;
+
+    u8 slot = memory[(u16)(iob + IOB_SLOT)];
+    u8 drive = memory[(u16)(iob + IOB_DRIVE)];
+    u8 volume = memory[(u16)(iob + IOB_VOLUME)];
+    u8 track = memory[(u16)(iob + IOB_TRACK)];
+    u8 sector = memory[(u16)(iob + IOB_SECTOR)];
+    u16 buffer = memory[(u16)(iob + IOB_BUFFER)] | (memory[(u16)(iob + IOB_BUFFER + 1)] << 8);
+    u8 command = memory[(u16)(iob + IOB_COMMAND)];
+    disk_t *disk = drive == 1 || drive == 2 ? cpu->disk_ctrl->drives[drive - 1] : NULL;
+
+    // Other slots, formatting and nibble images go through the real RWTS
+    if (slot != RWTS_SLOT || command > RWTS_WRITE) return false;
+    if (disk && disk->format != DSK) return false;
+
+    u8 error = RWTS_OK;
+    if (!disk || !disk->loaded || track >= TRACKS || sector >= SECTORS) {
+        error = RWTS_DRIVE_ERROR;
+    } else if (volume != 0 && volume != DISK_VOLUME) {
+        error = RWTS_VOLUME_MISMATCH;
+    } else if (command == RWTS_WRITE && disk->write_protect) {
+        error = RWTS_WRITE_PROTECTED;
+    } else {
+        // IOB sectors are DOS logical sectors, the same order as the .dsk
+        u8 *data = disk->dsk_data[track][sector];
+
+        if (command == RWTS_READ) {
+            for (int i = 0; i < BYTES; i++) write_memory(cpu, buffer + i, data[i]);
+        } else if (command == RWTS_WRITE) {
+            for (int i = 0; i < BYTES; i++) data[i] = read_memory(cpu, buffer + i);
+            mark_sector(disk, track, sector);
+            invalidate_track(disk, track);
+            flush_disk(disk);
+        }
+
+        // Leave the head where the real RWTS would have
+        disk->current_track = track;
+        disk->half_track = track * 2;
+        disk->phase = (track * 2) & 3;
+    }
+
+    memory[(u16)(iob + IOB_ERROR)] = error;
+    memory[(u16)(iob + IOB_VOLUME_FOUND)] = DISK_VOLUME;
+    memory[(u16)(iob + IOB_PREV_SLOT)] = slot;
+    memory[(u16)(iob + IOB_PREV_DRIVE)] = drive;
+
+    // Carry set on error, like RWTS
+    cpu->A = error;
+    set_flag_c(cpu, error != RWTS_OK);
+    cpu->global_cycles += cpu->rwts_cycles;
+    return true;
+}
+
+// Reads of the RWTS page: an opcode fetch at the entry point runs the trap and
+// hands the CPU an RTS, anything else reads RAM as normal
+static u8 rwts_read(cpu_t *cpu, u16 address)
+{
+    bool fetch = address == RWTS_ENTRY && cpu->PC == RWTS_ENTRY + 1;
+
+    if (fetch && memcmp(cpu->memory + RWTS_ENTRY, rwts_signature, sizeof(rwts_signature)) == 0 && run_rwts(cpu)) {
+        return 0x60;
+    }
+
+    return cpu->memory[address];
+}
+
+// Route reads of the RWTS page through the trap, writes stay direct
+void rwts_trap_init(cpu_t *cpu, u32 cycles)
+{
+    cpu->rwts_cycles = cycles;
+    cpu->read_pages[RWTS_ENTRY >> 8] = NULL;
+    cpu->io_read[RWTS_ENTRY >> 8] = rwts_read;
+}
@@ -0,0 +1,40 @@
+#ifndef RWTS_H
+#define RWTS_H
+
+#include "utils/util.h"
+#include "cpu/cpu.h"
+
+// DOS 3.3 RWTS Defines
+#define RWTS_ENTRY 0xBD00          // 48K DOS 3.3
+#define RWTS_DEFAULT_CYCLES 1000   // Charged per trapped call
+#define RWTS_SLOT 0x60             // Slot 6 times 16, the only controller emulated
+
+// I/O Block Offsets
+#define IOB_SLOT 0x01
+#define IOB_DRIVE 0x02
+#define IOB_VOLUME 0x03
+#define IOB_TRACK 0x04
+#define IOB_SECTOR 0x05
+#define IOB_BUFFER 0x08
+#define IOB_COMMAND 0x0C
+#define IOB_ERROR 0x0D
+#define IOB_VOLUME_FOUND 0x0E
+#define IOB_PREV_SLOT 0x0F
+#define IOB_PREV_DRIVE 0x10
+
+enum RWTS_COMMAND
+{
+    RWTS_SEEK = 0,
+    RWTS_READ = 1,
+    RWTS_WRITE = 2,
+};
+
+// RWTS Error Codes
+#define RWTS_OK 0x00
+#define RWTS_WRITE_PROTECTED 0x10
+#define RWTS_VOLUME_MISMATCH 0x20
+#define RWTS_DRIVE_ERROR 0x40
+
+void rwts_trap_init(cpu_t *cpu, u32 cycles);
+
+#endif
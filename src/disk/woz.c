@@ -0,0 +1,169 @@
+#include "woz.h"
+
+static u16 get16(const u8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static u32 get32(const u8 *p)
+{
+    return get16(p) | ((u32)get16(p + 2) << 16);
+}
+
+// Point the track table at the bit streams in the mapped file, nothing is copied or
+// decoded up front. The header CRC is not checked, load_disk takes its own of the file.
+bool woz_load(disk_t *disk)
+{
+    const u8 *image = disk->image;
+    size_t size = disk->image_size;
+
+    if (size < WOZ_HEADER_SIZE || memcmp(image, "WOZ", 3) != 0 || (image[3] != '1' && image[3] != '2')
+        || memcmp(image + 4, "\xFF\x0A\x0D\x0A", 4) != 0) {
+        fprintf(stderr, "Error: Not a WOZ image\n");
+        return false;
+    }
+    int version = image[3] - '0';
+
+    // Walk the chunks, unknown ones (META, WRIT, FLUX) are skipped
+    const u8 *info = NULL, *tmap = NULL, *trks = NULL;
+    u32 trks_size = 0;
+    size_t pos = WOZ_HEADER_SIZE;
+    while (pos + WOZ_CHUNK_HEADER <= size) {
+        const u8 *chunk = image + pos;
+        u32 chunk_size = get32(chunk + 4);
+        pos += WOZ_CHUNK_HEADER;
+        if (chunk_size > size - pos) break;
+
+        if (memcmp(chunk, "INFO", 4) == 0 && chunk_size >= 60) info = image + pos;
+        else if (memcmp(chunk, "TMAP", 4) == 0 && chunk_size >= WOZ_QUARTER_TRACKS) tmap = image + pos;
+        else if (memcmp(chunk, "TRKS", 4) == 0) { trks = image + pos; trks_size = chunk_size; }
+        pos += chunk_size;
+    }
+
+    if (!info || !tmap || !trks) {
+        fprintf(stderr, "Error: WOZ image is missing its INFO, TMAP or TRKS chunk\n");
+        return false;
+    }
+    if (info[1] != WOZ_DISK_525) {
+        fprintf(stderr, "Error: Only 5.25\" WOZ images are supported\n");
+        return false;
+    }
+
+    disk->woz_tracks = calloc(WOZ_QUARTER_TRACKS, sizeof(woz_track_t));
+    if (!disk->woz_tracks) {
+        fprintf(stderr, "Error: Could not allocate the WOZ track table\n");
+        return false;
+    }
+
+    // WOZ2 can ask for a faster or slower bit cell than the standard 4 us
+    disk->bit_timing = version >= 2 && info[39] ? info[39] : WOZ_BIT_TIMING;
+
+    for (int i = 0; i < WOZ_QUARTER_TRACKS; i++) {
+        woz_track_t *track = &disk->woz_tracks[i];
+
+        if (version == 1) {
+            if ((size_t)(i + 1) * WOZ1_TRACK_SIZE > trks_size) break;
+            track->offset = (trks - image) + i * WOZ1_TRACK_SIZE;
+            track->bit_count = get16(image + track->offset + WOZ1_BIT_COUNT);
+        } else {
+            if ((size_t)(i + 1) * 8 > trks_size) break;
+            const u8 *trk = trks + i * 8;
+            track->offset = get16(trk) * WOZ_BLOCK_SIZE;
+            track->bit_count = get32(trk + 4);
+        }
+
+        // A track running past the end of the file reads as unformatted
+        if (track->offset + ((u64)track->bit_count + 7) / 8 > size) track->bit_count = 0;
+    }
+
+    for (int quarter = 0; quarter < WOZ_QUARTER_TRACKS; quarter++) {
+        u8 index = tmap[quarter];
+        if (index >= WOZ_QUARTER_TRACKS || !disk->woz_tracks[index].bit_count) index = WOZ_NO_TRACK;
+        disk->woz_tmap[quarter] = index;
+    }
+
+    return true;
+}
+
+// The MC3470 amplifies noise into random bits when it sees no flux changes for a while
+static u8 weak_bit(void)
+{
+    static u32 noise = 0x2545F491;
+    noise ^= noise << 13;
+    noise ^= noise >> 17;
+    noise ^= noise << 5;
+    return noise & 1;
+}
+
+static const woz_track_t *head_track(const disk_t *disk)
+{
+    u8 index = disk->woz_tmap[disk->half_track * 2];
+    return index == WOZ_NO_TRACK ? NULL : &disk->woz_tracks[index];
+}
+
+// Shift bits from under the head into the data register, latching each complete nibble
+static void shift_bits(disk_t *disk, u64 bits)
+{
+    const woz_track_t *track = head_track(disk);
+    const u8 *data = track ? disk->image + track->offset : NULL;
+    u32 count = track ? track->bit_count : 0;
+    u32 pos = count ? disk->bit_pos % count : 0;
+
+    // Only the last few nibbles of a long gap could still be in the latch
+    if (bits > 64) {
+        if (count) pos = (pos + (bits - 64) % count) % count;
+        bits = 64;
+    }
+
+    for (; bits; bits--) {
+        u8 bit = 0;
+        if (count) {
+            bit = (data[pos >> 3] >> (~pos & 7)) & 1;
+            if (++pos == count) pos = 0;
+        }
+
+        if (bit) disk->zero_run = 0;
+        else if (++disk->zero_run > 3) bit = weak_bit();
+
+        // Leading zeros fall out of the register, which is how sync bytes frame the nibbles
+        disk->shift = (disk->shift << 1) | bit;
+        if (disk->shift & 0x80) {
+            disk->nibble = disk->shift;
+            disk->shift = 0;
+            disk->nibble_read = false;
+        }
+    }
+
+    disk->bit_pos = pos;
+}
+
+// Let the disk turn for the cycles since the last access, one bit per bit_timing
+void woz_spin(disk_t *disk, u64 cycles)
+{
+    u64 elapsed = (cycles - disk->spin_cycles) * 8 + disk->bit_remainder;
+    disk->spin_cycles = cycles;
+    disk->bit_remainder = elapsed % disk->bit_timing;
+    shift_bits(disk, elapsed / disk->bit_timing);
+}
+
+// Accelerated: run the disk until the next nibble is in the latch
+void woz_next_nibble(disk_t *disk, u64 cycles)
+{
+    for (int bit = 0; bit < 64 && disk->nibble_read; bit++) shift_bits(disk, 1);
+    disk->spin_cycles = cycles;
+    disk->bit_remainder = 0;
+}
+
+// Tracks differ in length, keep the head at the same angle on the new one
+void woz_move_head(disk_t *disk, int old_half_track)
+{
+    u8 old_index = disk->woz_tmap[old_half_track * 2];
+    u8 new_index = disk->woz_tmap[disk->half_track * 2];
+    if (old_index == new_index || new_index == WOZ_NO_TRACK) return;
+
+    u32 old_count = old_index == WOZ_NO_TRACK ? 0 : disk->woz_tracks[old_index].bit_count;
+    u32 new_count = disk->woz_tracks[new_index].bit_count;
+
+    if (old_count) disk->bit_pos = (u64)disk->bit_pos * new_count / old_count;
+    else disk->bit_pos %= new_count;
+}
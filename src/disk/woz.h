@@ -0,0 +1,20 @@
+#ifndef WOZ_H
+#define WOZ_H
+
+#include "utils/util.h"
+#include "disk/disk.h"
+
+// WOZ File Layout
+#define WOZ_HEADER_SIZE 12           // "WOZ1"/"WOZ2", FF 0A 0D 0A, CRC32
+#define WOZ_CHUNK_HEADER 8           // Chunk ID, then its size
+#define WOZ_BLOCK_SIZE 512           // WOZ2 track data is addressed in blocks
+#define WOZ1_TRACK_SIZE 6656         // WOZ1 fixed track record
+#define WOZ1_BIT_COUNT 6648          // Offset of the bit count within a WOZ1 record
+#define WOZ_DISK_525 1               // INFO disk type for a 5.25" disk
+
+bool woz_load(disk_t *disk);
+void woz_spin(disk_t *disk, u64 cycles);
+void woz_next_nibble(disk_t *disk, u64 cycles);
+void woz_move_head(disk_t *disk, int old_half_track);
+
+#endif
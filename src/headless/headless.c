@@ -0,0 +1,128 @@
+#include "headless.h"
+#include "state/state.h"
+#include <time.h>
+
+// Cycles run between keyboard/limit checks when no per-instruction condition is set
+#define HEADLESS_CHUNK 1000
+
+// --type starts after the reset routine has cleared the keyboard strobe (~0.5 s)
+#define TYPE_DELAY_CYCLES (CYCLES_PER_FRAME * 30)
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Hand the next character of --type to the keyboard latch once the last one was read
+static void feed_keyboard(cpu_t *cpu, const char **text)
+{
+    if (cpu->key_ready || **text == '\0' || cpu->global_cycles < TYPE_DELAY_CYCLES) return;
+
+    char c = **text;
+    (*text)++;
+
+    if (c == '\\' && **text == 'n') {
+        c = '\r';
+        (*text)++;
+    } else if (c == '\n') {
+        c = '\r';
+    } else if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+
+    cpu->key_value = c & 0x7F;
+    cpu->key_ready = true;
+}
+
+static bool stop_condition(cpu_t *cpu, const options_t *options)
+{
+    if (options->stop_on_pc && cpu->PC == options->stop_pc) return true;
+    if (options->stop_on_mem && cpu->memory[options->stop_mem_addr] == options->stop_mem_value) return true;
+    return false;
+}
+
+// Furthest an empty keyboard poll may skip while stop conditions are checked per instruction.
+// An idle loop writes no RAM and sits at one PC, so only typing or the cycle limit can end it.
+static u64 idle_horizon(const cpu_t *cpu, const options_t *options, const char *typing)
+{
+    if (*typing && cpu->global_cycles < TYPE_DELAY_CYCLES) return TYPE_DELAY_CYCLES;
+    if (options->max_cycles) return options->max_cycles;
+    return cpu->global_cycles + CPU_CLOCK_HZ;
+}
+
+int run_headless(cpu_t *cpu, const options_t *options)
+{
+    const char *typing = options->type_text ? options->type_text : "";
+    bool per_instruction = options->stop_on_pc || options->stop_on_mem;
+    int result = HEADLESS_STOPPED;
+
+    double start = seconds_now();
+
+    while (cpu->running) {
+        feed_keyboard(cpu, &typing);
+
+        if (per_instruction) {
+            if (stop_condition(cpu, options)) break;
+            cpu->cycle_deadline = idle_horizon(cpu, options, typing);
+            cpu_cycle(cpu);
+        } else {
+            u64 target = cpu->global_cycles + HEADLESS_CHUNK;
+            if (options->max_cycles && target > options->max_cycles) target = options->max_cycles;
+            cpu_run(cpu, target);
+        }
+
+        if (options->max_cycles && cpu->global_cycles >= options->max_cycles) {
+            if (per_instruction) result = HEADLESS_TIMEOUT;
+            break;
+        }
+    }
+
+    double elapsed = seconds_now() - start;
+    fprintf(stderr, "Ran %llu cycles in %.3f s (%.2f MHz), PC=%04X\n",
+            (unsigned long long)cpu->global_cycles, elapsed,
+            elapsed > 0 ? cpu->global_cycles / elapsed / 1e6 : 0.0, cpu->PC);
+
+    if (options->dump_text) dump_text_screen(cpu, stdout);
+    if (options->dump_mem_path && !dump_memory(cpu, options->dump_mem_path)) result = HEADLESS_ERROR;
+    if (options->save_state_path && !state_save_file(cpu, options->save_state_path)) result = HEADLESS_ERROR;
+
+    return result;
+}
+
+void dump_text_screen(cpu_t *cpu, FILE *out)
+{
+    for (int row = 0; row < 24; row++) {
+        u16 base_addr = 0x0400 + (row % 8) * 0x80 + (row / 8) * 0x28;
+        char line[41];
+
+        for (int col = 0; col < 40; col++) {
+            // Inverse & flashing characters live below 0x40
+            u8 c = cpu->memory[base_addr + col] & 0x7F;
+            line[col] = c < 0x20 ? c + 0x40 : c;
+        }
+        line[40] = '\0';
+
+        fprintf(out, "%s\n", line);
+    }
+}
+
+bool dump_memory(cpu_t *cpu, const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open %s for writing\n", path);
+        return false;
+    }
+
+    size_t written = fwrite(cpu->memory, 1, MEMORY_SIZE, f);
+    fclose(f);
+
+    if (written != MEMORY_SIZE) {
+        fprintf(stderr, "Error: Short write to %s\n", path);
+        return false;
+    }
+
+    return true;
+}
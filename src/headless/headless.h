@@ -0,0 +1,17 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "utils/util.h"
+#include "utils/options.h"
+#include "cpu/cpu.h"
+
+// Exit codes for batch runs
+#define HEADLESS_STOPPED 0    // --until-pc / --until-mem condition met (or cycle limit when no condition)
+#define HEADLESS_ERROR 1
+#define HEADLESS_TIMEOUT 2    // Cycle limit reached before the stop condition
+
+int run_headless(cpu_t *cpu, const options_t *options);
+void dump_text_screen(cpu_t *cpu, FILE *out);
+bool dump_memory(cpu_t *cpu, const char *path);
+
+#endif
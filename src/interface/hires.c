@@ -0,0 +1,289 @@
+#include "hires.h"
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HIRES_X86 1
+#include <immintrin.h>
+#endif
+
+// Colour: [column parity][previous byte bit 6][next byte bit 0][byte], mono: [byte]
+static u32 hires_color_table[2][2][2][256][HIRES_BYTE_PIXELS];
+static u32 hires_mono_table[256][HIRES_BYTE_PIXELS];
+
+// Mono pixel colours for the SIMD bit expansion
+static u32 mono_on_pixel;
+static u32 mono_off_pixel;
+
+// Artifact colour of a lone dot: even columns violet/blue, odd columns green/orange
+static int hires_dot_color(int odd, int palette)
+{
+    if (palette) return odd ? HR_ORANGE : HR_BLUE;
+    return odd ? HR_GREEN : HR_VIOLET;
+}
+
+// Decode every (parity, neighbour bits, byte) combination once, so rendering a
+// byte in colour is a single 14-pixel copy, the same cost as monochrome
+static void build_hires_tables(const u32 palette[6], u32 mono_on, u32 mono_off)
+{
+    for (int byte = 0; byte < 256; byte++) {
+        int pal = byte >> 7;
+
+        for (int bit = 0; bit < 7; bit++) {
+            u32 pixel = (byte >> bit) & 1 ? mono_on : mono_off;
+            hires_mono_table[byte][bit * 2] = pixel;
+            hires_mono_table[byte][bit * 2 + 1] = pixel;
+        }
+
+        for (int parity = 0; parity < 2; parity++) {
+            for (int prev = 0; prev < 2; prev++) {
+                for (int next = 0; next < 2; next++) {
+                    u32 *out = hires_color_table[parity][prev][next][byte];
+
+                    // Dots -1..7 so edges can look at the neighbouring bytes
+                    int dots[9];
+                    dots[0] = prev;
+                    for (int bit = 0; bit < 7; bit++) dots[bit + 1] = (byte >> bit) & 1;
+                    dots[8] = next;
+
+                    int colors[8];
+                    for (int i = 0; i < 8; i++) {
+                        int on = dots[i], left = i ? dots[i - 1] : 0, right = dots[i + 1];
+                        int odd = (parity + i + 1) & 1;  // i = 0 is the previous byte's last dot
+
+                        if (on && (left || right)) {
+                            colors[i] = HR_WHITE;
+                        } else if (on) {
+                            colors[i] = hires_dot_color(odd, pal);
+                        } else if (left && right) {
+                            // Gap between two dots of the same phase fills in with their colour
+                            colors[i] = hires_dot_color(!odd, pal);
+                        } else {
+                            colors[i] = HR_BLACK;
+                        }
+                    }
+
+                    // Palette 1 delays the byte by half a dot, so its first pixel still shows the previous dot
+                    for (int px = 0; px < HIRES_BYTE_PIXELS; px++) {
+                        int dot = pal ? (px + 1) / 2 : px / 2 + 1;
+                        out[px] = palette[colors[dot]];
+                    }
+                }
+            }
+        }
+    }
+}
+
+static inline const u32 *color_entry(const u8 *line, int col)
+{
+    u8 prev = col > 0 ? line[col - 1] : 0;
+    u8 next = col < HIRES_LINE_BYTES - 1 ? line[col + 1] : 0;
+    return hires_color_table[col & 1][(prev >> 6) & 1][next & 1][line[col]];
+}
+
+// Scalar Kernels
+static void expand_color_scalar(const u8 *line, u32 *dst)
+{
+    for (int col = 0; col < HIRES_LINE_BYTES; col++) {
+        memcpy(dst + col * HIRES_BYTE_PIXELS, color_entry(line, col), HIRES_BYTE_PIXELS * sizeof(u32));
+    }
+}
+
+static void expand_mono_scalar(const u8 *line, u32 *dst)
+{
+    for (int col = 0; col < HIRES_LINE_BYTES; col++) {
+        memcpy(dst + col * HIRES_BYTE_PIXELS, hires_mono_table[line[col]], HIRES_BYTE_PIXELS * sizeof(u32));
+    }
+}
+
+#ifdef HIRES_X86
+
+// Colour stays a 14-pixel table copy in every kernel: the parity and neighbour bits
+// are already resolved by the table, and memcpy of the entry measures faster than
+// moving it through vector registers. Only mono is expanded with SIMD.
+
+// SSE2 mono: the 7 bits are expanded straight into pixel masks with no table at all
+static void expand_mono_sse2(const u8 *line, u32 *dst)
+{
+    const __m128i m0 = _mm_setr_epi32(0x01, 0x01, 0x02, 0x02);
+    const __m128i m1 = _mm_setr_epi32(0x04, 0x04, 0x08, 0x08);
+    const __m128i m2 = _mm_setr_epi32(0x10, 0x10, 0x20, 0x20);
+    const __m128i m3 = _mm_setr_epi32(0x40, 0x40, 0x00, 0x00);
+    const __m128i off = _mm_set1_epi32((int)mono_off_pixel);
+    const __m128i diff = _mm_set1_epi32((int)(mono_on_pixel ^ mono_off_pixel));
+
+    for (int col = 0; col < HIRES_LINE_BYTES; col++) {
+        __m128i byte = _mm_set1_epi32(line[col]);
+        __m128i *out = (__m128i *)(dst + col * HIRES_BYTE_PIXELS);
+
+        // Lane is all ones where its dot is lit, then select on/off colour
+#define EXPAND(mask) _mm_xor_si128(off, _mm_and_si128(diff, _mm_cmpeq_epi32(_mm_and_si128(byte, mask), mask)))
+        _mm_storeu_si128(out, EXPAND(m0));
+        _mm_storeu_si128(out + 1, EXPAND(m1));
+        _mm_storeu_si128(out + 2, EXPAND(m2));
+        _mm_storel_epi64(out + 3, EXPAND(m3));
+#undef EXPAND
+    }
+}
+
+// AVX2 mono: 256 + 128 + 64 bits per byte
+__attribute__((target("avx2")))
+static void expand_mono_avx2(const u8 *line, u32 *dst)
+{
+    const __m256i m0 = _mm256_setr_epi32(0x01, 0x01, 0x02, 0x02, 0x04, 0x04, 0x08, 0x08);
+    const __m256i m1 = _mm256_setr_epi32(0x10, 0x10, 0x20, 0x20, 0x40, 0x40, 0x00, 0x00);
+    const __m256i off = _mm256_set1_epi32((int)mono_off_pixel);
+    const __m256i diff = _mm256_set1_epi32((int)(mono_on_pixel ^ mono_off_pixel));
+
+    for (int col = 0; col < HIRES_LINE_BYTES; col++) {
+        __m256i byte = _mm256_set1_epi32(line[col]);
+        u32 *out = dst + col * HIRES_BYTE_PIXELS;
+
+        __m256i lo = _mm256_xor_si256(off, _mm256_and_si256(diff, _mm256_cmpeq_epi32(_mm256_and_si256(byte, m0), m0)));
+        __m256i hi = _mm256_xor_si256(off, _mm256_and_si256(diff, _mm256_cmpeq_epi32(_mm256_and_si256(byte, m1), m1)));
+        _mm256_storeu_si256((__m256i *)out, lo);
+        _mm_storeu_si128((__m128i *)(out + 8), _mm256_castsi256_si128(hi));
+        _mm_storel_epi64((__m128i *)(out + 12), _mm256_extracti128_si256(hi, 1));
+    }
+}
+
+#endif
+
+static const hires_kernels_t kernels[] = {
+    { "scalar", expand_color_scalar, expand_mono_scalar },
+#ifdef HIRES_X86
+    { "sse2", expand_color_scalar, expand_mono_sse2 },
+    { "avx2", expand_color_scalar, expand_mono_avx2 },
+#endif
+};
+
+static const hires_kernels_t *active = &kernels[0];
+
+#define SELECT_FRAMES 20   // Frames timed per kernel when choosing one at startup
+#define TIMING_REPS 5      // Best of this many runs, single runs swing by a third
+
+// Widest kernel the host CPU supports
+static const hires_kernels_t *widest_kernel(void)
+{
+#ifdef HIRES_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &kernels[2];
+    if (__builtin_cpu_supports("sse2")) return &kernels[1];
+#endif
+    return &kernels[0];
+}
+
+static double seconds_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A random hi-res page, the same every time
+static void fill_page(u8 page[0x2000])
+{
+    u32 seed = 0x2000;
+    for (int i = 0; i < 0x2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        page[i] = seed >> 16;
+    }
+}
+
+static const u8 *page_line(const u8 *page, int y)
+{
+    return page + (y / 64) * 0x28 + ((y % 64) / 8) * 0x80 + (y % 8) * 0x400;
+}
+
+// Best time per 192-line frame over TIMING_REPS runs of frames each
+static double time_kernel(hires_kernel_t kernel, const u8 *page, int frames)
+{
+    static u32 output[HIRES_LINE_PIXELS];
+    double best = 0;
+
+    for (int rep = 0; rep < TIMING_REPS; rep++) {
+        double start = seconds_now();
+        for (int f = 0; f < frames; f++) {
+            for (int y = 0; y < 192; y++) kernel(page_line(page, y), output);
+        }
+        double elapsed = (seconds_now() - start) / frames;
+        if (rep == 0 || elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+// Pick the kernel that renders mono fastest on this host, a SIMD kernel is only
+// used when it measures faster than scalar (colour is the same copy in all of them)
+static const hires_kernels_t *select_kernel(void)
+{
+    static u8 page[0x2000];
+    fill_page(page);
+
+    const hires_kernels_t *fastest = &kernels[0];
+    double fastest_time = time_kernel(kernels[0].mono, page, SELECT_FRAMES);
+
+    for (const hires_kernels_t *k = kernels + 1; k <= widest_kernel(); k++) {
+        double time = time_kernel(k->mono, page, SELECT_FRAMES);
+        if (time < fastest_time) {
+            fastest = k;
+            fastest_time = time;
+        }
+    }
+
+    return fastest;
+}
+
+void hires_init(const u32 palette[6], u32 mono_on, u32 mono_off)
+{
+    mono_on_pixel = mono_on;
+    mono_off_pixel = mono_off;
+    build_hires_tables(palette, mono_on, mono_off);
+    active = select_kernel();
+}
+
+void hires_expand_line(const u8 *line, u32 *dst, bool color)
+{
+    if (color) active->color(line, dst);
+    else active->mono(line, dst);
+}
+
+const char *hires_kernel_name(void)
+{
+    return active->name;
+}
+
+// Check every kernel the host supports against the scalar output in an untimed
+// pass, then time each over full 192-line frames of a random hi-res page
+void hires_benchmark(int frames)
+{
+    static u8 page[0x2000];
+    static u32 reference[HIRES_LINE_PIXELS];
+    static u32 output[HIRES_LINE_PIXELS];
+    const hires_kernels_t *widest = widest_kernel();
+
+    fill_page(page);
+
+    printf("Hi-Res kernels, best of %d runs of %d frames of 192 lines (selected: %s)\n",
+           TIMING_REPS, frames, active->name);
+
+    for (const hires_kernels_t *k = kernels; k <= widest; k++) {
+        for (int color = 1; color >= 0; color--) {
+            // Every kernel shares the scalar colour copy, time it once
+            if (color && k != kernels) continue;
+
+            hires_kernel_t kernel = color ? k->color : k->mono;
+            hires_kernel_t scalar = color ? kernels[0].color : kernels[0].mono;
+            bool match = true;
+
+            for (int y = 0; y < 192; y++) {
+                kernel(page_line(page, y), output);
+                scalar(page_line(page, y), reference);
+                match &= memcmp(reference, output, sizeof(output)) == 0;
+            }
+
+            double elapsed = time_kernel(kernel, page, frames);
+            printf("  %-6s %-5s %8.2f us/frame%s\n", k->name, color ? "color" : "mono",
+                   elapsed * 1e6, match ? "" : "  (MISMATCH vs scalar)");
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef HIRES_H
+#define HIRES_H
+
+#include "utils/util.h"
+
+#define HIRES_LINE_BYTES 40
+#define HIRES_BYTE_PIXELS 14   // 7 dots, 2 framebuffer pixels each
+#define HIRES_LINE_PIXELS (HIRES_LINE_BYTES * HIRES_BYTE_PIXELS)
+
+enum HIRES_COLOR { HR_BLACK, HR_WHITE, HR_GREEN, HR_VIOLET, HR_ORANGE, HR_BLUE };
+
+// Expands one 40-byte scanline into 560 packed pixels
+typedef void (*hires_kernel_t)(const u8 *line, u32 *dst);
+
+typedef struct
+{
+    const char *name;
+    hires_kernel_t color;
+    hires_kernel_t mono;
+} hires_kernels_t;
+
+void hires_init(const u32 palette[6], u32 mono_on, u32 mono_off);
+void hires_expand_line(const u8 *line, u32 *dst, bool color);
+const char *hires_kernel_name(void);
+void hires_benchmark(int frames);
+
+#endif
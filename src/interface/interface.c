@@ -1,5 +1,7 @@
 #include "interface.h"
 #include "font.h"
+#include "hires.h"
+#include "state/state.h"
 
 u16 row_addresses[24] = {
     0x0400, 0x0480, 0x0500, 0x0580,
@@ -38,6 +40,68 @@ u8 hires_colors[6][3] = {
     {20,  207, 253},  // blue   (palette 1, even pixel)
 };
 
+// Lo-Res palette packed into framebuffer pixel format
+static u32 lores_pixels[16];
+
+#define TEXT_ON  PIXEL_RGB(0, 255, 0)
+#define TEXT_OFF PIXEL_RGB(0, 0, 0)
+
+// Text glyphs pre-expanded to framebuffer pixels: [normal/inverse][glyph][line * width]
+#define GLYPH_WIDTH (CHAR_WIDTH * 2)
+static u32 glyph_atlas[2][64][CHAR_HEIGHT * GLYPH_WIDTH];
+
+// Glyph to draw for each video byte, per flash phase (indexed by cursor_visible)
+static const u32 *glyph_lookup[2][256];
+
+// Pack the Hi-Res palette and build the byte expansion tables
+static void init_hires(void)
+{
+    u32 palette[6];
+    for (int i = 0; i < 6; i++) {
+        palette[i] = PIXEL_RGB(hires_colors[i][0], hires_colors[i][1], hires_colors[i][2]);
+    }
+    hires_init(palette, TEXT_ON, TEXT_OFF);
+}
+
+static void build_glyph_atlas(void)
+{
+    for (int style = 0; style < 2; style++) {
+        for (int glyph = 0; glyph < 64; glyph++) {
+            u32 *dst = glyph_atlas[style][glyph];
+
+            for (int py = 0; py < CHAR_HEIGHT; py++) {
+                u8 glyph_row = apple2_font_std[glyph][py];
+
+                for (int px = 0; px < CHAR_WIDTH; px++) {
+                    bool lit = ((glyph_row >> px) & 1) ^ style;
+                    dst[py * GLYPH_WIDTH + px * 2] = lit ? TEXT_ON : TEXT_OFF;
+                    dst[py * GLYPH_WIDTH + px * 2 + 1] = lit ? TEXT_ON : TEXT_OFF;
+                }
+            }
+        }
+    }
+
+    for (int byte = 0; byte < 256; byte++) {
+        // Font is stored from 0x20 (space), video codes start at 0x00 (@)
+        u8 char_index = byte & 0x3F;
+        if (char_index >= 0x20)
+            char_index -= 0x20;
+        else
+            char_index += 0x20;
+
+        // Top 2 bits: 00 inverse, 01 flashing, 1x normal
+        for (int phase = 0; phase < 2; phase++) {
+            int style;
+            switch (byte & 0xC0) {
+                case 0x00: style = 1; break;
+                case 0x40: style = phase ? 0 : 1; break;
+                default:   style = 0; break;
+            }
+            glyph_lookup[phase][byte] = glyph_atlas[style][char_index];
+        }
+    }
+}
+
 bool init_interface(interface_t *interface)
 {
     // Initialize Video
@@ -47,7 +111,7 @@ bool init_interface(interface_t *interface)
     }
 
     // Initialize Window
-    interface->window = SDL_CreateWindow("Apple2-EMU", 560, 384, SDL_WINDOW_OPENGL);
+    interface->window = SDL_CreateWindow("Apple2-EMU", WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_OPENGL);
     if (interface->window == NULL) {
         SDL_Log("Window could not be created! SDL_Error: %s", SDL_GetError());
         SDL_Quit();
@@ -63,9 +127,43 @@ bool init_interface(interface_t *interface)
         return false;
     }
 
+    // Initialize Streaming Texture & CPU-Side Framebuffer
+    interface->texture = SDL_CreateTexture(interface->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_STREAMING, FB_WIDTH, FB_HEIGHT);
+    interface->framebuffer = calloc(FB_WIDTH * FB_HEIGHT, sizeof(u32));
+    if (interface->texture == NULL || interface->framebuffer == NULL) {
+        SDL_Log("Framebuffer could not be created! SDL_Error: %s", SDL_GetError());
+        if (interface->texture) SDL_DestroyTexture(interface->texture);
+        free(interface->framebuffer);
+        SDL_DestroyRenderer(interface->renderer);
+        SDL_DestroyWindow(interface->window);
+        SDL_Quit();
+        return false;
+    }
+    SDL_SetTextureScaleMode(interface->texture, SDL_SCALEMODE_NEAREST);
+
+    // Presenting blocks on vsync here, never in the emulation thread
+    SDL_SetRenderVSync(interface->renderer, 1);
+
+    for (int i = 0; i < 16; i++) {
+        lores_pixels[i] = PIXEL_RGB(lores_colors[i][0], lores_colors[i][1], lores_colors[i][2]);
+    }
+    build_glyph_atlas();
+    init_hires();
+
     // Set Text Mode
     interface->render_mode = TEXT;
+    interface->redraw = true;
+    triple_buffer_init(&interface->frames);
+    atomic_init(&interface->running, true);
+    atomic_init(&interface->pending_key, 0);
+    atomic_init(&interface->reset_request, false);
+    atomic_init(&interface->state_request, STATE_NONE);
+    atomic_init(&interface->speed_khz, 0);
+    audio_ring_init(&interface->audio);
+    interface->audio_stream = NULL;
     interface->cursor_visible = true;
+    interface->last_cursor = true;
     interface->txt_cols = STD_COL;
     interface->txt_rows = TXT_ROW;
 
@@ -75,13 +173,14 @@ bool init_interface(interface_t *interface)
     interface->low_width = LOW_RES_WIDTH;
 
     // Set High-Res Mode
+    interface->color_screen = true;
     interface->high_width = HGR_WIDTH_MONO;
     interface->high_height = HGR_HEIGHT;
 
     return true;
 }
 
-void poll_keyboard(interface_t *interface, cpu_t *cpu)
+void poll_keyboard(interface_t *interface)
 {
     SDL_Event event;
     SDL_KeyboardEvent current_key;
@@ -90,7 +189,7 @@ void poll_keyboard(interface_t *interface, cpu_t *cpu)
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
             case SDL_EVENT_QUIT:
-                cpu->running = false;
+                atomic_store(&interface->running, false);
                 break;
             case SDL_EVENT_KEY_DOWN:
                 current_key = event.key;
@@ -114,13 +213,8 @@ void poll_keyboard(interface_t *interface, cpu_t *cpu)
 
                 if (current_key.mod & SDL_KMOD_CTRL) {
                     if (current_key.key == SDLK_DELETE) { 
-                        // Point Back to Reset Vector
-                        cpu->PC = cpu->RESET_LOC;
-                        cpu->text_mode = true;
-                        cpu->low_res = false;
-                        cpu->high_res = false;
-                        cpu->mixed_mode = false;
-                        cpu->key_ready = false;
+                        // Applied by the emulation thread at the end of its frame
+                        atomic_store(&interface->reset_request, true);
                     }
                 }
 
@@ -136,11 +230,13 @@ void poll_keyboard(interface_t *interface, cpu_t *cpu)
                     case SDLK_MINUS:     key_hit = current_key.mod & SDL_KMOD_SHIFT ? '_' : '-'; break;
                     case SDLK_EQUALS:    key_hit = current_key.mod & SDL_KMOD_SHIFT ? '+' : '='; break;
                     case SDLK_APOSTROPHE:     key_hit = current_key.mod & SDL_KMOD_SHIFT ? '\"' : '\''; break;
+                    case SDLK_F5:        atomic_store(&interface->state_request, STATE_SAVE); break;
+                    case SDLK_F8:        atomic_store(&interface->state_request, STATE_REWIND); break;
+                    case SDLK_F9:        atomic_store(&interface->state_request, STATE_LOAD); break;
                 }
 
                 if (key_hit) {
-                    cpu->key_value = key_hit & 0x7F;
-                    cpu->key_ready = true;
+                    atomic_store(&interface->pending_key, (key_hit & 0x7F) | KEY_PENDING);
                     key_hit = 0;
                 }
                 break;
@@ -151,183 +247,252 @@ void poll_keyboard(interface_t *interface, cpu_t *cpu)
     }
 }
 
-void render_text_screen(interface_t *interface, cpu_t *cpu, int start_row)
+void render_text_screen(interface_t *interface, const video_frame_t *frame, int start_row, u32 dirty_rows)
 {
-    for (int row = start_row; row < interface->txt_rows; row++) {
-        u16 base_addr = row_addresses[row];
+    const u32 **glyphs = glyph_lookup[interface->cursor_visible];
 
-        for (int col = 0; col < interface->txt_cols; col++) {
-            u8 video_byte = read_memory(cpu, base_addr + col);
-
-            // Determine render mode from top 2 bits
-            u8 mode;
-            u8 top2 = video_byte & 0xC0;
-            switch (top2) {
-                // Inverse
-                case 0x00:
-                    mode = 1; 
-                    break;
-                // Flashing
-                case 0x40:
-                    mode = interface->cursor_visible ? 0 : 1; 
-                    break;
-                // Normal
-                default:
-                    mode = 0; 
-                    break;
-            }
+    for (int row = start_row; row < interface->txt_rows; row++) {
+        if (!(dirty_rows & (1u << row))) continue;
 
-            u8 char_index = video_byte & 0x3F;
-            if (char_index >= 0x20)
-                char_index -= 0x20;
-            else
-                char_index += 0x20;
+        const u8 *text = frame->text + row_addresses[row] - TEXT_PAGE_START;
+        u32 *row_start = interface->framebuffer + (row * CHAR_HEIGHT) * FB_WIDTH;
 
-            int x = col * CHAR_WIDTH;
-            int y = row * CHAR_HEIGHT;
+        for (int col = 0; col < interface->txt_cols; col++) {
+            const u32 *glyph = glyphs[text[col]];
+            u32 *dst = row_start + col * GLYPH_WIDTH;
 
             for (int py = 0; py < CHAR_HEIGHT; py++) {
-                u8 glyph_row = apple2_font_std[char_index][py];
-
-                for (int px = 0; px < CHAR_WIDTH; px++) {
-                    bool lit = (glyph_row >> px) & 1;
-
-                    // inverse: flip pixels
-                    if (mode == 1) lit = !lit;
-
-                    SDL_SetRenderDrawColor(
-                        interface->renderer,
-                        lit ? 0   : 0,    // R  
-                        lit ? 255 : 0,    // G  
-                        lit ? 0   : 0,    // B
-                        255
-                    );
-
-                    SDL_FRect rect = {
-                        (float)(x + px) * 2,
-                        (float)(y + py) * 2,
-                        (float)2,
-                        (float)2
-                    };
-                    SDL_RenderFillRect(interface->renderer, &rect);
-                }
+                memcpy(dst, glyph + py * GLYPH_WIDTH, GLYPH_WIDTH * sizeof(u32));
+                dst += FB_WIDTH;
             }
         }
     }
 }
 
-void render_lowres_screen(interface_t *interface, cpu_t *cpu, int num_rows)
+// Fill a block of framebuffer pixels with a single colour
+static void fill_block(interface_t *interface, int x, int y, int w, int h, u32 pixel)
+{
+    u32 *dst = interface->framebuffer + y * FB_WIDTH + x;
+
+    for (int py = 0; py < h; py++) {
+        for (int px = 0; px < w; px++) {
+            dst[px] = pixel;
+        }
+        dst += FB_WIDTH;
+    }
+}
+
+void render_lowres_screen(interface_t *interface, const video_frame_t *frame, int num_rows, u32 dirty_rows)
 {
     for (int row = 0; row < num_rows; row++) {
-        u16 base_addr = row_addresses[row];
+        if (!(dirty_rows & (1u << row))) continue;
+
+        const u8 *text = frame->text + row_addresses[row] - TEXT_PAGE_START;
 
         for (int col = 0; col < interface->low_width; col++) {
-            u8 byte = read_memory(cpu, base_addr + col);
+            u8 byte = text[col];
 
             u8 top_color = byte & 0x0F;
             u8 bottom_color = (byte >> 4 ) & 0x0F;
 
+            // Each block is 7 dots wide and 4 lines high
             int x = col * 14;
-            int top_y = row * 16;
-            int bottom_y = (row * 16) + 8;
-
-            // Draw Top Pixel
-            SDL_SetRenderDrawColor(
-                interface->renderer,
-                    lores_colors[top_color][0],
-                    lores_colors[top_color][1],
-                    lores_colors[top_color][2],
-                    255
-            );
-
-            SDL_FRect top_rect = {
-                x, top_y, 14, 8
-            };
-
-            SDL_RenderFillRect(interface->renderer, &top_rect);
-
-            // Draw Bottom Pixel
-            SDL_SetRenderDrawColor(
-                interface->renderer,
-                    lores_colors[bottom_color][0],
-                    lores_colors[bottom_color][1],
-                    lores_colors[bottom_color][2],
-                    255
-            );
-
-            SDL_FRect bottom_rect = {
-                x, bottom_y, 14, 8
-            };
-
-            SDL_RenderFillRect(interface->renderer, &bottom_rect);
+            int top_y = row * 8;
+            int bottom_y = (row * 8) + 4;
+
+            fill_block(interface, x, top_y, 14, 4, lores_pixels[top_color]);
+            fill_block(interface, x, bottom_y, 14, 4, lores_pixels[bottom_color]);
         }
     }
 }
 
-void render_hires_screen(interface_t *interface, cpu_t *cpu, int num_rows)
+void render_hires_screen(interface_t *interface, const video_frame_t *frame, int num_rows, const u64 dirty_lines[3])
 {
-    // Going to treat this as a mono screen for now
     for (int py = 0; py < num_rows; py++) {
+        if (!(dirty_lines[py / 64] & (1ull << (py % 64)))) continue;
+
         int group = py / 64;
         int block = (py % 64) / 8;
         int line  = py % 8;
 
-        u16 base_addr = 0x2000
-                      + (group * 0x28)
-                      + (block * 0x80)
-                      + (line  * 0x400);
+        u16 offset = (group * 0x28)
+                   + (block * 0x80)
+                   + (line  * 0x400);
+
+        hires_expand_line(frame->hires + offset, interface->framebuffer + py * FB_WIDTH, interface->color_screen);
+    }
+}
+
+void benchmark_hires(int frames)
+{
+    init_hires();
+    hires_benchmark(frames);
+}
 
-        int screen_x = 0;
+bool run_display(interface_t *interface)
+{
+    u32 dirty_rows;
+    u64 hires_lines[3];
+    const video_frame_t *frame = triple_buffer_acquire(&interface->frames, &dirty_rows, hires_lines);
 
-        for (int px = 0; px < 40; px++) {
-            u8 byte = read_memory(cpu, base_addr + px);
+    u8 mode = frame->text_mode ? TEXT : frame->low_res ? LOW : frame->high_res ? HIGH : BLANK;
 
-            for (int bit = 0; bit < 7; bit++) {
-                bool pixel = (byte >> bit) & 1;
+    // A mode switch repaints everything, a cursor flash repaints the text rows
+    bool full = interface->redraw || mode != interface->render_mode || frame->mixed_mode != interface->mixed_mode;
+    bool flash = interface->cursor_visible != interface->last_cursor;
 
-                SDL_SetRenderDrawColor(interface->renderer,
-                0,
-                pixel ? 255 : 0,
-                0,
-                255);
+    u32 graphics_rows = full ? ALL_TEXT_ROWS : dirty_rows;
+    u32 text_rows = (full || flash) ? ALL_TEXT_ROWS : dirty_rows;
+    bool changed = full || flash || text_rows;
 
-                SDL_FRect rect = {screen_x * 2, py * 2, 2, 2};
-                SDL_RenderFillRect(interface->renderer, &rect);
-                screen_x++;
-            }
-        }
+    for (int i = 0; i < 3; i++) {
+        if (full) hires_lines[i] = ~0ull;
+        changed |= hires_lines[i] != 0;
     }
-}
 
-void run_display(interface_t *interface, cpu_t *cpu)
-{ 
-    // Clear Screen
-    SDL_SetRenderDrawColor(interface->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-    SDL_RenderClear(interface->renderer);  
-
-    if (cpu->text_mode) {
-        render_text_screen(interface, cpu, 0);
-    } else if (cpu->low_res) {
-        if (cpu->mixed_mode) {
-            render_lowres_screen(interface, cpu, TXT_ROW - 4);
-            render_text_screen(interface, cpu, TXT_ROW - 4);
+    if (mode == TEXT) {
+        render_text_screen(interface, frame, 0, text_rows);
+    } else if (mode == LOW) {
+        if (frame->mixed_mode) {
+            render_lowres_screen(interface, frame, TXT_ROW - 4, graphics_rows);
+            render_text_screen(interface, frame, TXT_ROW - 4, text_rows);
         } else {
-            render_lowres_screen(interface, cpu, TXT_ROW);
+            render_lowres_screen(interface, frame, TXT_ROW, graphics_rows);
         }
-    } else if (cpu->high_res) {
-        if (cpu->mixed_mode) {
-            render_hires_screen(interface, cpu, interface->high_height - 32);
-            render_text_screen(interface, cpu, TXT_ROW - 4);
+    } else if (mode == HIGH) {
+        if (frame->mixed_mode) {
+            render_hires_screen(interface, frame, interface->high_height - 32, hires_lines);
+            render_text_screen(interface, frame, TXT_ROW - 4, text_rows);
         } else {
-            render_hires_screen(interface, cpu, interface->high_height);
+            render_hires_screen(interface, frame, interface->high_height, hires_lines);
         }
+    } else if (full) {
+        memset(interface->framebuffer, 0, FB_WIDTH * FB_HEIGHT * sizeof(u32));
     }
 
+    // Everything dirty has now been drawn
+    interface->render_mode = mode;
+    interface->mixed_mode = frame->mixed_mode;
+    interface->last_cursor = interface->cursor_visible;
+    interface->redraw = false;
+
+    // Nothing new from the emulation thread: keep showing the last frame
+    if (!changed) return false;
+
+    // Upload the changed frame, then stretch it over the window
+    SDL_UpdateTexture(interface->texture, NULL, interface->framebuffer, FB_WIDTH * sizeof(u32));
+    SDL_RenderClear(interface->renderer);
+    SDL_RenderTexture(interface->renderer, interface->texture, NULL, NULL);
     SDL_RenderPresent(interface->renderer);
+    return true;
+}
+
+// Emulation thread: hand keys, resets and state hotkeys queued by poll_keyboard to the CPU
+// Returns true when a state load or rewind moved global_cycles, frame timing has to restart from it
+bool apply_input(interface_t *interface, cpu_t *cpu, rewind_t *rewind)
+{
+    bool clock_jumped = false;
+
+    if (atomic_exchange(&interface->reset_request, false)) {
+        // Point Back to Reset Vector
+        cpu->PC = cpu->RESET_LOC;
+        cpu->text_mode = true;
+        cpu->low_res = false;
+        cpu->high_res = false;
+        cpu->mixed_mode = false;
+        cpu->key_ready = false;
+    }
+
+    switch (atomic_exchange(&interface->state_request, STATE_NONE)) {
+        case STATE_SAVE:
+            if (state_save_file(cpu, STATE_PATH)) SDL_Log("Saved state to %s", STATE_PATH);
+            break;
+        case STATE_LOAD:
+            if (state_load_file(cpu, STATE_PATH)) {
+                SDL_Log("Loaded state from %s", STATE_PATH);
+                clock_jumped = true;
+            }
+            break;
+        case STATE_REWIND:
+            if (rewind && rewind_step_back(rewind, cpu, REWIND_STEP_CYCLES)) {
+                SDL_Log("Rewound, %.1f s of history left (%u KB)", rewind_seconds(rewind),
+                        rewind_bytes_used(rewind) / 1024);
+                clock_jumped = true;
+            }
+            break;
+    }
+
+    int key = atomic_exchange(&interface->pending_key, 0);
+    if (key) {
+        cpu->key_value = key & 0x7F;
+        cpu->key_ready = true;
+    }
+
+    return clock_jumped;
+}
+
+void show_speed(interface_t *interface, u32 khz)
+{
+    char title[64];
+    snprintf(title, sizeof(title), "Apple2-EMU - %.3f MHz", khz / 1000.0);
+    SDL_SetWindowTitle(interface->window, title);
+}
+
+// Audio thread: hand the device whatever the ring holds, topped up on underrun
+static void SDLCALL feed_audio(void *userdata, SDL_AudioStream *stream, int additional_amount, int total_amount)
+{
+    audio_ring_t *ring = userdata;
+    i16 samples[1024];
+    (void)total_amount;
+
+    int needed = additional_amount / (int)sizeof(i16);
+    while (needed > 0) {
+        int count = needed < 1024 ? needed : 1024;
+        audio_ring_pop(ring, samples, count);
+        SDL_PutAudioStreamData(stream, samples, count * sizeof(i16));
+        needed -= count;
+    }
+}
+
+// Open a mono 16-bit stream pulling from the speaker ring, false leaves sound off
+bool init_audio(interface_t *interface)
+{
+    if (!SDL_InitSubSystem(SDL_INIT_AUDIO)) {
+        SDL_Log("Audio could not initialize! SDL_Error: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_AudioSpec spec = { SDL_AUDIO_S16, 1, AUDIO_SAMPLE_RATE };
+    interface->audio_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec,
+                                                        feed_audio, &interface->audio);
+    if (interface->audio_stream == NULL) {
+        SDL_Log("Audio stream could not be created! SDL_Error: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_ResumeAudioStreamDevice(interface->audio_stream);
+    return true;
+}
+
+// Emulation thread: turn the frame's speaker clicks into samples and queue them
+void play_speaker(interface_t *interface, cpu_t *cpu)
+{
+    static i16 samples[SPEAKER_BUFFER];
+    if (!cpu->speaker) return;
+
+    size_t count = speaker_render(cpu->speaker, cpu->global_cycles, samples, SPEAKER_BUFFER);
+    audio_ring_push(&interface->audio, samples, count);
 }
 
 void end_interface(interface_t *interface)
 {
+    if (interface->audio_stream) {
+        SDL_DestroyAudioStream(interface->audio_stream);
+        SDL_Log("Audio: %u underruns, %u overruns", atomic_load(&interface->audio.underruns),
+                atomic_load(&interface->audio.overruns));
+    }
+    SDL_DestroyTexture(interface->texture);
+    free(interface->framebuffer);
     SDL_DestroyRenderer(interface->renderer);
     SDL_DestroyWindow(interface->window);
     SDL_Quit();
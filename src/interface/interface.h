@@ -3,6 +3,9 @@
 
 #include "utils/util.h"
 #include "cpu/cpu.h"
+#include "interface/triple_buffer.h"
+#include "audio/audio_ring.h"
+#include "state/rewind.h"
 #include "SDL3/SDL.h"
 
 // Text Mode Defines
@@ -21,21 +24,59 @@
 #define HGR_WIDTH_COLOR 140
 #define HGR_HEIGHT 192
 
+// Framebuffer Defines (2 framebuffer pixels per Apple II dot, scaled 2x vertically on present)
+#define FB_WIDTH 560
+#define FB_HEIGHT 192
+#define WINDOW_WIDTH 560
+#define WINDOW_HEIGHT 384
+
+// Set on pending_key while a keypress waits for the emulation thread
+#define KEY_PENDING 0x100
+
+// Save state & rewind hotkeys (F5 / F9 / F8) queued for the emulation thread
+enum STATE_REQUEST
+{
+    STATE_NONE,
+    STATE_SAVE,
+    STATE_LOAD,
+    STATE_REWIND,
+};
+
+// Pack an opaque ARGB8888 pixel
+#define PIXEL_RGB(r, g, b) (0xFF000000u | ((u32)(r) << 16) | ((u32)(g) << 8) | (u32)(b))
+
 enum RENDER_MODE
 {
     TEXT,
     LOW,
     HIGH,
+    BLANK,
 };
 
 typedef struct 
 {
     SDL_Window *window;
     SDL_Renderer *renderer;
-    u8 render_mode;
+    SDL_Texture *texture;
+    u32 *framebuffer; // FB_WIDTH * FB_HEIGHT ARGB pixels, uploaded once per frame
+    u8 render_mode;   // Mode of the last presented frame
+    bool redraw;      // Repaint every row on the next frame
+
+    // Shared with the emulation thread
+    triple_buffer_t frames;
+    atomic_bool running;
+    atomic_int pending_key;      // Key | KEY_PENDING, 0 when empty
+    atomic_bool reset_request;
+    atomic_int state_request;
+    atomic_uint speed_khz;       // Achieved speed, updated about once a second
+    audio_ring_t audio;          // Speaker samples on their way to the audio callback
+
+    // Sound
+    SDL_AudioStream *audio_stream;   // NULL when sound is off
     
     // Text Mode
     bool cursor_visible;
+    bool last_cursor;
     u8 txt_rows;
     u8 txt_cols;
 
@@ -51,11 +92,16 @@ typedef struct
 } interface_t;
 
 bool init_interface(interface_t *interface);
-void poll_keyboard(interface_t *interface, cpu_t *cpu);
-void render_text_screen(interface_t *interface, cpu_t *cpu, int start_rows);
-void render_lowres_screen(interface_t *interface, cpu_t *cpu, int num_rows);
-void render_hires_screen(interface_t *interface, cpu_t *cpu, int num_rows);
-void run_display(interface_t *interface, cpu_t *cpu);
+void poll_keyboard(interface_t *interface);
+bool apply_input(interface_t *interface, cpu_t *cpu, rewind_t *rewind);
+void render_text_screen(interface_t *interface, const video_frame_t *frame, int start_rows, u32 dirty_rows);
+void render_lowres_screen(interface_t *interface, const video_frame_t *frame, int num_rows, u32 dirty_rows);
+void render_hires_screen(interface_t *interface, const video_frame_t *frame, int num_rows, const u64 dirty_lines[3]);
+bool run_display(interface_t *interface);
+bool init_audio(interface_t *interface);
+void play_speaker(interface_t *interface, cpu_t *cpu);
+void show_speed(interface_t *interface, u32 khz);
+void benchmark_hires(int frames);
 void end_interface(interface_t *interface);
 
 #endif
\ No newline at end of file
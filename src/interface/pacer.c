@@ -0,0 +1,86 @@
+#include "pacer.h"
+#include "SDL3/SDL.h"
+
+void pacer_init(pacer_t *pacer, u64 cycles_per_frame, u64 clock_hz, u64 global_cycles)
+{
+    pacer->frequency = SDL_GetPerformanceFrequency();
+    pacer->cycles_per_frame = cycles_per_frame;
+    pacer->frame_ticks = pacer->frequency * cycles_per_frame / clock_hz;
+    pacer->spin_ticks = pacer->frequency * PACER_SPIN_NS / 1000000000ull;
+    pacer->deadline = SDL_GetPerformanceCounter();
+
+    pacer->report_start = pacer->deadline;
+    pacer->report_cycles = global_cycles;
+    pacer->mhz = 0.0;
+}
+
+// Sleep until the end of the current frame period
+void pacer_wait(pacer_t *pacer)
+{
+    u64 now = SDL_GetPerformanceCounter();
+    pacer->deadline += pacer->frame_ticks;
+
+    // Late: run the next frame straight away, unless we're too far behind to catch up
+    if (now >= pacer->deadline) {
+        if (now - pacer->deadline > pacer->frame_ticks * PACER_MAX_CATCHUP) {
+            pacer->deadline = now;
+        }
+        return;
+    }
+
+    u64 remaining = pacer->deadline - now;
+    if (remaining > pacer->spin_ticks) {
+        SDL_DelayNS((remaining - pacer->spin_ticks) * 1000000000ull / pacer->frequency);
+    }
+
+    while (SDL_GetPerformanceCounter() < pacer->deadline) {
+        // Spin out the last fraction of a millisecond
+    }
+}
+
+// Start pacing and the speed report from now, after a stretch of unthrottled frames
+// or a jump in global_cycles
+void pacer_reset(pacer_t *pacer, u64 global_cycles)
+{
+    pacer->deadline = SDL_GetPerformanceCounter();
+    pacer->report_start = pacer->deadline;
+    pacer->report_cycles = global_cycles;
+}
+
+// Audio-clock pacing: sleep while the ring holds more than the target, then return
+// how many cycles to run next. A ring below target gets a slightly longer frame and
+// one above a slightly shorter one, so the fill settles without audible speed changes.
+u64 pacer_wait_audio(pacer_t *pacer, audio_ring_t *ring)
+{
+    u64 start = SDL_GetPerformanceCounter();
+    size_t fill = audio_ring_fill(ring);
+
+    // A stalled device would never drain, give up after a few frames and run anyway
+    while (fill > AUDIO_SYNC_TARGET) {
+        if (SDL_GetPerformanceCounter() - start > pacer->frame_ticks * PACER_MAX_CATCHUP) break;
+        SDL_DelayNS(AUDIO_SYNC_POLL_NS);
+        fill = audio_ring_fill(ring);
+    }
+
+    double error = ((double)AUDIO_SYNC_TARGET - (double)fill) / AUDIO_SYNC_TARGET;
+    double adjust = error * AUDIO_SYNC_GAIN;
+    if (adjust > AUDIO_SYNC_MAX_ADJUST) adjust = AUDIO_SYNC_MAX_ADJUST;
+    if (adjust < -AUDIO_SYNC_MAX_ADJUST) adjust = -AUDIO_SYNC_MAX_ADJUST;
+
+    // Keep the wall-clock deadline current so switching modes doesn't burst
+    pacer->deadline = SDL_GetPerformanceCounter();
+    return (u64)(pacer->cycles_per_frame * (1.0 + adjust));
+}
+
+// Updates the achieved speed about once a second, returns true when it changed
+bool pacer_report(pacer_t *pacer, u64 global_cycles)
+{
+    u64 now = SDL_GetPerformanceCounter();
+    u64 elapsed = now - pacer->report_start;
+    if (elapsed < pacer->frequency) return false;
+
+    pacer->mhz = (double)(global_cycles - pacer->report_cycles) * pacer->frequency / elapsed / 1e6;
+    pacer->report_start = now;
+    pacer->report_cycles = global_cycles;
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include "utils/util.h"
+#include "audio/audio_ring.h"
+
+#define PACER_SPIN_NS 1000000      // Busy-wait the last 1 ms instead of trusting the OS sleep
+#define PACER_MAX_CATCHUP 4        // Frames we try to catch up before dropping the backlog
+
+// Audio-Clock Pacing Defines
+#define AUDIO_SYNC_TARGET 2048     // Samples kept queued ahead of the device (about 43 ms)
+#define AUDIO_SYNC_GAIN 0.01       // Frame length change for a ring that is empty or at target
+#define AUDIO_SYNC_MAX_ADJUST 0.005
+#define AUDIO_SYNC_POLL_NS 1000000 // Sleep between checks of a full ring
+
+typedef struct
+{
+    u64 frequency;      // Performance counter ticks per second
+    u64 cycles_per_frame;
+    u64 frame_ticks;    // Ticks per emulated frame
+    u64 spin_ticks;
+    u64 deadline;       // Counter value the current frame should end at
+
+    // Speed Report
+    u64 report_start;
+    u64 report_cycles;
+    double mhz;
+} pacer_t;
+
+void pacer_init(pacer_t *pacer, u64 cycles_per_frame, u64 clock_hz, u64 global_cycles);
+void pacer_wait(pacer_t *pacer);
+void pacer_reset(pacer_t *pacer, u64 global_cycles);
+u64 pacer_wait_audio(pacer_t *pacer, audio_ring_t *ring);
+bool pacer_report(pacer_t *pacer, u64 global_cycles);
+
+#endif
@@ -0,0 +1,52 @@
+#include "triple_buffer.h"
+
+void triple_buffer_init(triple_buffer_t *buffer)
+{
+    memset(buffer->frames, 0, sizeof(buffer->frames));
+    buffer->back = 0;
+    buffer->front = 1;
+    atomic_init(&buffer->middle, 2);
+
+    atomic_init(&buffer->text_dirty, 0);
+    for (int i = 0; i < 3; i++) {
+        atomic_init(&buffer->hires_dirty[i], 0);
+    }
+}
+
+// Emulation thread: snapshot page 1 and the video switches, then hand the frame over
+void triple_buffer_publish(triple_buffer_t *buffer, cpu_t *cpu)
+{
+    video_frame_t *frame = &buffer->frames[buffer->back];
+
+    memcpy(frame->text, cpu->memory + TEXT_PAGE_START, FRAME_TEXT_SIZE);
+    memcpy(frame->hires, cpu->memory + HIRES_PAGE_START, FRAME_HIRES_SIZE);
+    frame->text_mode = cpu->text_mode;
+    frame->low_res = cpu->low_res;
+    frame->high_res = cpu->high_res;
+    frame->mixed_mode = cpu->mixed_mode;
+
+    buffer->back = atomic_exchange(&buffer->middle, buffer->back | FRAME_FRESH) & ~FRAME_FRESH;
+
+    // Dirty rows follow the frame holding them, so the consumer never clears rows it can't see yet
+    atomic_fetch_or(&buffer->text_dirty, cpu->text_dirty[0]);
+    for (int i = 0; i < 3; i++) {
+        atomic_fetch_or(&buffer->hires_dirty[i], cpu->hires_dirty[0][i]);
+    }
+    cpu->text_dirty[0] = 0;
+    memset(cpu->hires_dirty[0], 0, sizeof(cpu->hires_dirty[0]));
+}
+
+// Render thread: take the dirty rows first, then the newest frame, which already holds them
+const video_frame_t *triple_buffer_acquire(triple_buffer_t *buffer, u32 *text_dirty, u64 hires_dirty[3])
+{
+    *text_dirty = atomic_exchange(&buffer->text_dirty, 0);
+    for (int i = 0; i < 3; i++) {
+        hires_dirty[i] = atomic_exchange(&buffer->hires_dirty[i], 0);
+    }
+
+    if (atomic_load(&buffer->middle) & FRAME_FRESH) {
+        buffer->front = atomic_exchange(&buffer->middle, buffer->front) & ~FRAME_FRESH;
+    }
+
+    return &buffer->frames[buffer->front];
+}
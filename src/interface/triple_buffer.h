@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include "utils/util.h"
+#include "cpu/cpu.h"
+#include <stdatomic.h>
+
+// Display page 1 as seen by the renderer
+#define FRAME_TEXT_SIZE 0x0400   // $0400-$07FF
+#define FRAME_HIRES_SIZE 0x2000  // $2000-$3FFF
+
+// Middle slot index flag: set when the producer published a frame the consumer hasn't taken
+#define FRAME_FRESH 0x4
+
+// Video memory and soft switches captured at the end of an emulated frame
+typedef struct
+{
+    u8 text[FRAME_TEXT_SIZE];
+    u8 hires[FRAME_HIRES_SIZE];
+    bool text_mode;
+    bool low_res;
+    bool high_res;
+    bool mixed_mode;
+} video_frame_t;
+
+// Lock-free single-producer/single-consumer triple buffer. The emulation thread
+// fills its back slot and swaps it with the middle one, the render thread swaps
+// the middle slot out when it is fresh, so neither side ever waits on the other.
+typedef struct
+{
+    video_frame_t frames[3];
+    int back;            // Owned by the producer
+    int front;           // Owned by the consumer
+    atomic_int middle;   // Slot index | FRAME_FRESH
+
+    // Rows written since the consumer last took them, ORed in after each publish
+    atomic_uint text_dirty;
+    atomic_ullong hires_dirty[3];
+} triple_buffer_t;
+
+void triple_buffer_init(triple_buffer_t *buffer);
+void triple_buffer_publish(triple_buffer_t *buffer, cpu_t *cpu);
+const video_frame_t *triple_buffer_acquire(triple_buffer_t *buffer, u32 *text_dirty, u64 hires_dirty[3]);
+
+#endif
@@ -1,42 +1,160 @@
 #include "cpu/cpu.h"
 #include "interface/interface.h"
+#include "interface/pacer.h"
+#include "headless/headless.h"
+#include "state/state.h"
+#include "disk/rwts.h"
+#include "utils/options.h"
+
+typedef struct
+{
+    cpu_t *cpu;
+    interface_t *interface;
+    rewind_t *rewind;   // NULL when rewind is off
+    bool fast_disk;     // Run unthrottled while a drive motor is on
+    bool audio_sync;    // Pace from the audio ring's fill level instead of the wall clock
+} emulation_t;
+
+// Restart frame deadlines and pacing from the CPU's clock, at startup (which may
+// follow --load-state) and whenever a state load or rewind moves global_cycles
+static void anchor_clock(pacer_t *pacer, u64 *frame_end, const cpu_t *cpu)
+{
+    *frame_end = cpu->global_cycles;
+    pacer_reset(pacer, cpu->global_cycles);
+}
+
+// Emulation thread: runs and paces the 6502, publishing a video snapshot each frame
+static int run_emulation(void *data)
+{
+    emulation_t *emulation = data;
+    cpu_t *cpu = emulation->cpu;
+    interface_t *interface = emulation->interface;
+
+    pacer_t pacer;
+    pacer_init(&pacer, CYCLES_PER_FRAME, CPU_CLOCK_HZ, cpu->global_cycles);
+
+    // Overshoot from the last instruction of a frame is carried into the next
+    u64 frame_end;
+    anchor_clock(&pacer, &frame_end, cpu);
+    bool accelerating = false;
+    u64 frame_cycles = CYCLES_PER_FRAME;
+
+    while (cpu->running && atomic_load(&interface->running))
+    {
+        frame_end += frame_cycles;
+        cpu_run(cpu, frame_end);
+
+        if (emulation->rewind) rewind_record(emulation->rewind, cpu);
+        play_speaker(interface, cpu);
+        if (apply_input(interface, cpu, emulation->rewind)) anchor_clock(&pacer, &frame_end, cpu);
+        triple_buffer_publish(&interface->frames, cpu);
+
+        if (pacer_report(&pacer, cpu->global_cycles)) atomic_store(&interface->speed_khz, (u32)(pacer.mhz * 1000.0));
+
+        // Disk access runs flat out, paced speed resumes once the motor stops
+        bool accelerate = emulation->fast_disk && cpu->disk_ctrl->motor_on;
+        frame_cycles = CYCLES_PER_FRAME;
+        if (!accelerate && emulation->audio_sync) {
+            frame_cycles = pacer_wait_audio(&pacer, &interface->audio);
+        } else if (!accelerate) {
+            if (accelerating) pacer_reset(&pacer, cpu->global_cycles);
+            pacer_wait(&pacer);
+        }
+        accelerating = accelerate;
+    }
+
+    atomic_store(&interface->running, false);
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    options_t options;
+    if (!parse_options(&options, argc, argv)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Micro-benchmark of the hi-res kernels, no window or ROM needed
+    if (options.bench_hires) {
+        benchmark_hires(options.bench_hires);
+        return EXIT_SUCCESS;
+    }
+
     // Initialize CPU & Interface
-    cpu_t cpu;
+    cpu_t *cpu = cpu_create();
     interface_t interface;
+    if (!cpu) return EXIT_FAILURE;
 
-    cpu_init(&cpu);
+    cpu->idle_skip = !options.no_idle_skip;
+    cpu->disk_ctrl->fast = options.fast_disk;
 
-    if (!init_interface(&interface))
+    // Batch runs never touch SDL video
+    if (options.headless) {
+        int status = EXIT_FAILURE;
+        if (!init_software(cpu)) {
+            fprintf(stderr, "There was an error loading the Apple II Rom\n");
+        } else if (init_disks(cpu, options.disk1_path, options.disk2_path)) {
+            if (options.rwts_trap) rwts_trap_init(cpu, options.rwts_cycles);
+            if (!options.load_state_path || state_load_file(cpu, options.load_state_path)) {
+                status = run_headless(cpu, &options);
+            }
+        }
+        cpu_destroy(cpu);
+        return status;
+    }
+
+    if (!init_interface(&interface)) {
+        cpu_destroy(cpu);
         return EXIT_FAILURE;
+    }
+    interface.color_screen = !options.mono;
+
+    // Sound is optional, the emulator runs silent without an audio device
+    if (!options.no_sound && init_audio(&interface)) {
+        cpu->speaker = speaker_create(CPU_CLOCK_HZ, AUDIO_SAMPLE_RATE);
+        if (!cpu->speaker) fprintf(stderr, "Error: Could not allocate the speaker\n");
+    }
 
     // Load Software
-    if (!init_software(&cpu))
+    if (!init_software(cpu))
     {
         fprintf(stderr, "There was an error loading the Apple II Rom\n");
-        cpu.running = false;
+        atomic_store(&interface.running, false);
+    }
+    else if (!init_disks(cpu, options.disk1_path, options.disk2_path))
+    {
+        atomic_store(&interface.running, false);
+    }
+    else if (options.load_state_path && !state_load_file(cpu, options.load_state_path))
+    {
+        atomic_store(&interface.running, false);
+    }
+    else if (options.rwts_trap)
+    {
+        rwts_trap_init(cpu, options.rwts_cycles);
     }
 
-    /*
-    // Check if there's a disk loaded
-    cpu.drive1 = load_disk();
-    if (!cpu.drive1.loaded) cpu.running = false;
-    */
+    emulation_t emulation = { cpu, &interface, NULL, options.fast_disk, options.audio_sync && cpu->speaker };
+    if (options.audio_sync && !cpu->speaker) fprintf(stderr, "Error: --audio-sync needs sound, pacing from the clock instead\n");
+    if (options.rewind_seconds) {
+        emulation.rewind = rewind_create(options.rewind_seconds);
+        if (!emulation.rewind) fprintf(stderr, "Error: Could not allocate the rewind buffer\n");
+    }
+
+    SDL_Thread *thread = SDL_CreateThread(run_emulation, "emulation", &emulation);
+    if (thread == NULL) {
+        SDL_Log("Emulation thread could not be created! SDL_Error: %s", SDL_GetError());
+        atomic_store(&interface.running, false);
+    }
 
     u32 last_flash = SDL_GetTicks();
+    u32 shown_khz = 0;
 
-    while (cpu.running)
+    // This thread only handles input and presents the frames the emulation thread publishes
+    while (atomic_load(&interface.running))
     {
-        u64 frame_start = SDL_GetPerformanceCounter();
-
-        for (int i = 0; i < CYCLES_PER_FRAME; i++)
-        {
-            cpu_cycle(&cpu);
-        }
-
-        poll_keyboard(&interface, &cpu);
+        poll_keyboard(&interface);
 
         // Determine if Cursor should be flashing (300 ms)
         u32 now = SDL_GetTicks();
@@ -46,10 +164,18 @@ int main(int argc, char *argv[])
             last_flash = now;
         }
 
-        run_display(&interface, &cpu);
-        SDL_Delay(16);
+        if (!run_display(&interface)) SDL_Delay(1);
+
+        u32 khz = atomic_load(&interface.speed_khz);
+        if (khz != shown_khz) {
+            show_speed(&interface, khz);
+            shown_khz = khz;
+        }
     }
 
+    if (thread) SDL_WaitThread(thread, NULL);
+    rewind_destroy(emulation.rewind);
+    cpu_destroy(cpu);
     end_interface(&interface);
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
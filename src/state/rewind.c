@@ -0,0 +1,219 @@
+#include "rewind.h"
+
+rewind_t *rewind_create(int seconds)
+{
+    rewind_t *rewind = calloc(1, sizeof(rewind_t));
+    if (!rewind) return NULL;
+
+    // Room for the span plus the keyframe interval evicted at a time
+    rewind->span = (u64)seconds * CPU_CLOCK_HZ;
+    rewind->frame_capacity = (rewind->span + REWIND_KEYFRAME_CYCLES) / REWIND_MIN_FRAME_CYCLES + 1;
+    rewind->data_capacity = (seconds + 1) * REWIND_BYTES_PER_SECOND;
+    rewind->frames = malloc(rewind->frame_capacity * sizeof(rewind_frame_t));
+    rewind->data = malloc(rewind->data_capacity);
+
+    if (!rewind->frames || !rewind->data) {
+        rewind_destroy(rewind);
+        return NULL;
+    }
+
+    return rewind;
+}
+
+void rewind_destroy(rewind_t *rewind)
+{
+    if (!rewind) return;
+    free(rewind->frames);
+    free(rewind->data);
+    free(rewind);
+}
+
+// XOR the current RAM against reference 8 bytes at a time, storing only the words that
+// differ as runs of (u16 skip, u16 length, XOR bytes). NULL reference means zeroed RAM.
+static u32 encode_delta(const u8 *memory, const u8 *reference, u8 *out)
+{
+    u32 size = 0;
+    u32 last_end = 0;
+    u32 pos = 0;
+
+    while (pos < REWIND_RAM_SIZE) {
+        u64 word, ref = 0;
+        memcpy(&word, memory + pos, 8);
+        if (reference) memcpy(&ref, reference + pos, 8);
+        if (word == ref) {
+            pos += 8;
+            continue;
+        }
+
+        // Extend the run over every differing word that follows
+        u32 start = pos;
+        u8 *header = out + size;
+        size += 4;
+
+        do {
+            u64 diff = word ^ ref;
+            memcpy(out + size, &diff, 8);
+            size += 8;
+            pos += 8;
+            if (pos >= REWIND_RAM_SIZE) break;
+
+            memcpy(&word, memory + pos, 8);
+            ref = 0;
+            if (reference) memcpy(&ref, reference + pos, 8);
+        } while (word != ref);
+
+        u16 skip = start - last_end;
+        u16 length = pos - start;
+        memcpy(header, &skip, 2);
+        memcpy(header + 2, &length, 2);
+        last_end = pos;
+    }
+
+    return size;
+}
+
+// XOR is its own inverse, so the same record moves RAM either way between two frames
+static void apply_delta(u8 *memory, const u8 *in, u32 size)
+{
+    const u8 *end = in + size;
+    u32 pos = 0;
+
+    while (in < end) {
+        u16 skip, length;
+        memcpy(&skip, in, 2);
+        memcpy(&length, in + 2, 2);
+        in += 4;
+        pos += skip;
+
+        for (u32 i = 0; i < length; i++) {
+            memory[pos + i] ^= in[i];
+        }
+        in += length;
+        pos += length;
+    }
+}
+
+static rewind_frame_t *frame_at(const rewind_t *rewind, u32 index)
+{
+    return &rewind->frames[(rewind->first + index) % rewind->frame_capacity];
+}
+
+// Drop the oldest keyframe and its deltas, so the oldest frame can still be rebuilt
+static void evict_oldest(rewind_t *rewind)
+{
+    do {
+        rewind->first = (rewind->first + 1) % rewind->frame_capacity;
+        rewind->count--;
+    } while (rewind->count && !frame_at(rewind, 0)->keyframe);
+}
+
+// True if [start, start + size) would overwrite a stored record
+static bool overlaps_history(const rewind_t *rewind, u32 start, u32 size)
+{
+    if (!rewind->count) return false;
+
+    u32 oldest = frame_at(rewind, 0)->offset;
+    u32 end = start + size;
+
+    if (oldest < rewind->head) return start < rewind->head && end > oldest;
+
+    // History wraps: [oldest, capacity) and [0, head)
+    return end > oldest || start < rewind->head;
+}
+
+// Called once per emulated frame, whatever its length
+void rewind_record(rewind_t *rewind, const cpu_t *cpu)
+{
+    // History older than the span by a whole keyframe interval can go, the span still remains
+    while (rewind->count
+           && cpu->global_cycles - frame_at(rewind, 0)->regs.global_cycles > rewind->span + REWIND_KEYFRAME_CYCLES) {
+        evict_oldest(rewind);
+    }
+
+    // Start a keyframe every emulated second, or when the history was emptied
+    bool keyframe = rewind->count == 0 || cpu->global_cycles - rewind->keyframe_cycles >= REWIND_KEYFRAME_CYCLES;
+
+    u32 size = encode_delta(cpu->memory, keyframe ? NULL : rewind->previous, rewind->scratch);
+    memcpy(rewind->previous, cpu->memory, REWIND_RAM_SIZE);
+
+    // Records are contiguous, one that won't fit before the end starts back at 0
+    u32 start = rewind->head;
+    if (start + size > rewind->data_capacity) start = 0;
+
+    while (rewind->count == rewind->frame_capacity || overlaps_history(rewind, start, size)) {
+        evict_oldest(rewind);
+    }
+
+    // The oldest frame must be a keyframe, anything else has lost its base
+    if (!rewind->count && !keyframe) {
+        size = encode_delta(cpu->memory, NULL, rewind->scratch);
+        keyframe = true;
+        start = rewind->head + size > rewind->data_capacity ? 0 : rewind->head;
+    }
+
+    memcpy(rewind->data + start, rewind->scratch, size);
+    rewind->head = start + size;
+
+    rewind_frame_t *frame = frame_at(rewind, rewind->count++);
+    state_save_regs(cpu, &frame->regs);
+    frame->offset = start;
+    frame->size = size;
+    frame->keyframe = keyframe;
+    if (keyframe) rewind->keyframe_cycles = cpu->global_cycles;
+}
+
+// Restore the newest frame at least the given cycles older than the newest one, or the
+// oldest frame kept, and forget everything newer
+bool rewind_step_back(rewind_t *rewind, cpu_t *cpu, u64 cycles)
+{
+    if (rewind->count < 2) return false;
+
+    u64 newest = frame_at(rewind, rewind->count - 1)->regs.global_cycles;
+    u32 target = rewind->count - 1;
+    while (target > 0 && newest - frame_at(rewind, target)->regs.global_cycles < cycles) target--;
+
+    u32 key = target;
+    while (!frame_at(rewind, key)->keyframe) key--;
+
+    // Keyframe first, then every delta up to the target
+    memset(rewind->previous, 0, REWIND_RAM_SIZE);
+    for (u32 i = key; i <= target; i++) {
+        rewind_frame_t *frame = frame_at(rewind, i);
+        apply_delta(rewind->previous, rewind->data + frame->offset, frame->size);
+    }
+
+    rewind_frame_t *frame = frame_at(rewind, target);
+    memcpy(cpu->memory, rewind->previous, REWIND_RAM_SIZE);
+    state_load_regs(cpu, &frame->regs);
+
+    // The disk controller and drives are left as they are, only their clocks follow
+    // global_cycles back so the disk doesn't spin through the jump
+    for (int i = 0; i < 2; i++) {
+        disk_t *disk = cpu->disk_ctrl->drives[i];
+        disk->spin_cycles = cpu->global_cycles;
+        disk->bit_remainder = 0;
+    }
+
+    rewind->count = target + 1;
+    rewind->head = frame->offset + frame->size;
+    rewind->keyframe_cycles = frame_at(rewind, key)->regs.global_cycles;
+    return true;
+}
+
+double rewind_seconds(const rewind_t *rewind)
+{
+    if (!rewind->count) return 0;
+
+    u64 oldest = frame_at(rewind, 0)->regs.global_cycles;
+    u64 newest = frame_at(rewind, rewind->count - 1)->regs.global_cycles;
+    return (double)(newest - oldest) / CPU_CLOCK_HZ;
+}
+
+u32 rewind_bytes_used(const rewind_t *rewind)
+{
+    if (!rewind->count) return 0;
+
+    u32 oldest = frame_at(rewind, 0)->offset;
+    if (oldest < rewind->head) return rewind->head - oldest;
+    return rewind->data_capacity - oldest + rewind->head;
+}
@@ -0,0 +1,51 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "utils/util.h"
+#include "cpu/cpu.h"
+#include "state/state.h"
+
+#define REWIND_RAM_SIZE 0xC000          // Only RAM changes, ROM & I/O are left out
+// History is measured in global_cycles, frames vary in length under --audio-sync
+#define REWIND_KEYFRAME_CYCLES CPU_CLOCK_HZ  // Full snapshot once an emulated second
+#define REWIND_BYTES_PER_SECOND 0x14000      // Ring budget per second of history (keyframe + deltas)
+#define REWIND_STEP_CYCLES CPU_CLOCK_HZ      // One hotkey press goes back an emulated second
+#define REWIND_MIN_FRAME_CYCLES (CYCLES_PER_FRAME - CYCLES_PER_FRAME / 100)  // Shortest frame to size for
+
+// Worst case XOR-RLE record: every other 8-byte word differs
+#define REWIND_MAX_RECORD (REWIND_RAM_SIZE + REWIND_RAM_SIZE / 4)
+
+typedef struct
+{
+    state_regs_t regs;
+    u32 offset;     // Start of the XOR-RLE record in the ring
+    u32 size;
+    bool keyframe;  // XOR against zeroed RAM rather than the previous frame
+} rewind_frame_t;
+
+// Fixed-size history: frame records in one ring, their XOR-RLE memory data in another
+typedef struct
+{
+    rewind_frame_t *frames;
+    u32 frame_capacity;
+    u32 first;          // Oldest frame, always a keyframe
+    u32 count;
+    u64 span;           // Cycles of history to keep
+    u64 keyframe_cycles; // global_cycles of the newest keyframe
+
+    u8 *data;
+    u32 data_capacity;
+    u32 head;           // Where the next record goes
+
+    u8 previous[REWIND_RAM_SIZE];  // RAM as of the newest frame
+    u8 scratch[REWIND_MAX_RECORD];
+} rewind_t;
+
+rewind_t *rewind_create(int seconds);
+void rewind_destroy(rewind_t *rewind);
+void rewind_record(rewind_t *rewind, const cpu_t *cpu);
+bool rewind_step_back(rewind_t *rewind, cpu_t *cpu, u64 cycles);
+double rewind_seconds(const rewind_t *rewind);
+u32 rewind_bytes_used(const rewind_t *rewind);
+
+#endif
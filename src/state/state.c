@@ -0,0 +1,285 @@
+#include "state.h"
+
+void state_save_regs(const cpu_t *cpu, state_regs_t *regs)
+{
+    regs->A = cpu->A;
+    regs->X = cpu->X;
+    regs->Y = cpu->Y;
+    regs->SP = cpu->SP;
+    regs->PC = cpu->PC;
+    regs->B = cpu->B;
+    regs->D = cpu->D;
+    regs->I = cpu->I;
+    regs->v_result = cpu->v_result;
+    regs->nz_result = cpu->nz_result;
+    regs->c_result = cpu->c_result;
+
+    regs->text_mode = cpu->text_mode;
+    regs->low_res = cpu->low_res;
+    regs->high_res = cpu->high_res;
+    regs->mixed_mode = cpu->mixed_mode;
+    regs->key_value = cpu->key_value;
+    regs->key_ready = cpu->key_ready;
+
+    regs->disk_selected = cpu->disk_ctrl->selected;
+    regs->disk_phases = cpu->disk_ctrl->phases;
+    regs->disk_motor_on = cpu->disk_ctrl->motor_on;
+    regs->disk_q6 = cpu->disk_ctrl->q6;
+    regs->disk_q7 = cpu->disk_ctrl->q7;
+    regs->disk_latch = cpu->disk_ctrl->latch;
+
+    regs->global_cycles = cpu->global_cycles;
+}
+
+// Memory and the disk controller are restored separately, every display row is
+// assumed to have changed
+void state_load_regs(cpu_t *cpu, const state_regs_t *regs)
+{
+    cpu->A = regs->A;
+    cpu->X = regs->X;
+    cpu->Y = regs->Y;
+    cpu->SP = regs->SP;
+    cpu->PC = regs->PC;
+    cpu->B = regs->B;
+    cpu->D = regs->D;
+    cpu->I = regs->I;
+    cpu->v_result = regs->v_result;
+    cpu->nz_result = regs->nz_result;
+    cpu->c_result = regs->c_result;
+
+    cpu->text_mode = regs->text_mode;
+    cpu->low_res = regs->low_res;
+    cpu->high_res = regs->high_res;
+    cpu->mixed_mode = regs->mixed_mode;
+    cpu->key_value = regs->key_value;
+    cpu->key_ready = regs->key_ready;
+
+    cpu->global_cycles = regs->global_cycles;
+
+    // Idle detection restarts, every display row has changed
+    cpu->poll_pc = 0;
+    cpu->poll_count = 0;
+    cpu->poll_cycles = cpu->global_cycles;
+    cpu->poll_activity = cpu->activity;
+    for (int page = 0; page < 2; page++) {
+        cpu->text_dirty[page] = ALL_TEXT_ROWS;
+        memset(cpu->hires_dirty[page], 0xFF, sizeof(cpu->hires_dirty[page]));
+    }
+}
+
+// Only full state loads restore the controller, together with the drives' heads and
+// track caches, so its latches and stepper phases always match them
+static void load_controller(disk_controller_t *ctrl, const state_regs_t *regs)
+{
+    ctrl->selected = regs->disk_selected & 1;
+    ctrl->phases = regs->disk_phases;
+    ctrl->motor_on = regs->disk_motor_on;
+    ctrl->q6 = regs->disk_q6;
+    ctrl->q7 = regs->disk_q7;
+    ctrl->latch = regs->disk_latch;
+}
+
+// Head position and dirty mask, then the dirty sectors themselves
+static size_t save_drive(const disk_t *disk, u8 *out)
+{
+    state_drive_t drive;
+    drive.image_size = disk->image_size;
+    drive.image_crc = disk->image_crc;
+    drive.current_track = disk->current_track;
+    drive.half_track = disk->half_track;
+    drive.phase = disk->phase;
+    drive.head_pos = disk->head_pos;
+    drive.spin_cycles = disk->spin_cycles;
+    drive.bit_pos = disk->bit_pos;
+    drive.bit_remainder = disk->bit_remainder;
+    drive.shift = disk->shift;
+    drive.nibble = disk->nibble;
+    drive.zero_run = disk->zero_run;
+    drive.format = disk->format;
+    drive.loaded = disk->loaded;
+    drive.write_protect = disk->write_protect;
+    memcpy(drive.dirty_sectors, disk->dirty_sectors, sizeof(drive.dirty_sectors));
+
+    memcpy(out, &drive, sizeof(drive));
+    size_t size = sizeof(drive);
+
+    for (int track = 0; track < TRACKS; track++) {
+        for (int sector = 0; sector < SECTORS; sector++) {
+            if (!(disk->dirty_sectors[track] & (1u << sector))) continue;
+            memcpy(out + size, disk->dsk_data[track][sector], BYTES);
+            size += BYTES;
+        }
+    }
+
+    return size;
+}
+
+// Size of a saved drive block, 0 if it runs past the end of the state
+static size_t drive_size(const u8 *in, size_t remaining)
+{
+    state_drive_t drive;
+    if (remaining < sizeof(drive)) return 0;
+    memcpy(&drive, in, sizeof(drive));
+
+    size_t size = sizeof(drive);
+    for (int track = 0; track < TRACKS; track++) {
+        size += __builtin_popcount(drive.dirty_sectors[track]) * BYTES;
+    }
+
+    return size <= remaining ? size : 0;
+}
+
+// The sectors in a drive block are only meaningful over the image they were saved from
+static bool same_image(const disk_t *disk, const u8 *in)
+{
+    state_drive_t drive;
+    memcpy(&drive, in, sizeof(drive));
+
+    if (drive.loaded != disk->loaded) return false;
+    return !disk->loaded || (drive.format == disk->format && drive.image_size == disk->image_size
+                             && drive.image_crc == disk->image_crc);
+}
+
+// Sectors saved are put back, ones written since are rolled back to how they were mounted
+static void load_drive(disk_t *disk, const u8 *in)
+{
+    state_drive_t drive;
+    memcpy(&drive, in, sizeof(drive));
+    size_t size = sizeof(drive);
+
+    for (int track = 0; track < TRACKS && disk->dsk_data; track++) {
+        for (int sector = 0; sector < SECTORS; sector++) {
+            u16 bit = 1u << sector;
+            if (drive.dirty_sectors[track] & bit) {
+                restore_sector(disk, track, sector, in + size);
+                size += BYTES;
+            } else if (disk->dirty_sectors[track] & bit) {
+                restore_sector(disk, track, sector, NULL);
+            }
+        }
+    }
+
+    disk->current_track = drive.current_track % TRACKS;
+    disk->half_track = drive.half_track;
+    disk->phase = drive.phase & 3;
+    disk->head_pos = drive.head_pos % TRACK_NIBBLES;
+    disk->spin_cycles = drive.spin_cycles;
+    disk->bit_pos = drive.bit_pos;
+    disk->bit_remainder = disk->bit_timing ? drive.bit_remainder % disk->bit_timing : 0;
+    disk->shift = drive.shift;
+    disk->nibble = drive.nibble;
+    disk->zero_run = drive.zero_run;
+    // Format and write protection stay with the mounted file
+    memcpy(disk->dirty_sectors, drive.dirty_sectors, sizeof(disk->dirty_sectors));
+    disk->nibbles_valid = 0;
+    disk->nibble_read = false;
+    disk->track_written = false;
+}
+
+// Serialize the machine into buffer, returns the state size or 0 when it doesn't fit
+size_t state_save(const cpu_t *cpu, u8 *buffer, size_t capacity)
+{
+    if (capacity < STATE_MAX_SIZE) return 0;
+
+    state_header_t header = { STATE_MAGIC, STATE_VERSION, sizeof(state_core_t), 2 };
+    memcpy(buffer, &header, sizeof(header));
+    size_t size = sizeof(header);
+
+    state_core_t *core = (state_core_t *)(buffer + size);
+    state_save_regs(cpu, &core->regs);
+    memcpy(core->memory, cpu->memory, MEMORY_SIZE);
+    size += sizeof(state_core_t);
+
+    size += save_drive(cpu->disk_ctrl->drives[0], buffer + size);
+    size += save_drive(cpu->disk_ctrl->drives[1], buffer + size);
+
+    return size;
+}
+
+// Disk sectors are deltas, so a state is refused unless the same images are mounted
+bool state_load(cpu_t *cpu, const u8 *buffer, size_t size)
+{
+    state_header_t header;
+    if (size < sizeof(header) + sizeof(state_core_t)) return false;
+    memcpy(&header, buffer, sizeof(header));
+
+    if (header.magic != STATE_MAGIC || header.version != STATE_VERSION
+        || header.core_size != sizeof(state_core_t) || header.drive_count != 2) {
+        fprintf(stderr, "Error: Incompatible save state (version %u)\n", header.version);
+        return false;
+    }
+
+    // Check both drive blocks before touching the machine
+    size_t offsets[2];
+    size_t offset = sizeof(header) + sizeof(state_core_t);
+    for (int i = 0; i < 2; i++) {
+        size_t used = drive_size(buffer + offset, size - offset);
+        if (!used) {
+            fprintf(stderr, "Error: Save state is truncated\n");
+            return false;
+        }
+        if (!same_image(cpu->disk_ctrl->drives[i], buffer + offset)) {
+            fprintf(stderr, "Error: Save state was made with a different disk in drive %d\n", i + 1);
+            return false;
+        }
+        offsets[i] = offset;
+        offset += used;
+    }
+
+    const state_core_t *core = (const state_core_t *)(buffer + sizeof(header));
+    memcpy(cpu->memory, core->memory, MEMORY_SIZE);
+    state_load_regs(cpu, &core->regs);
+    load_controller(cpu->disk_ctrl, &core->regs);
+    load_drive(cpu->disk_ctrl->drives[0], buffer + offsets[0]);
+    load_drive(cpu->disk_ctrl->drives[1], buffer + offsets[1]);
+
+    return true;
+}
+
+bool state_save_file(const cpu_t *cpu, const char *path)
+{
+    u8 *buffer = malloc(STATE_MAX_SIZE);
+    if (!buffer) return false;
+
+    size_t size = state_save(cpu, buffer, STATE_MAX_SIZE);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open %s for writing\n", path);
+        free(buffer);
+        return false;
+    }
+
+    size_t written = fwrite(buffer, 1, size, f);
+    fclose(f);
+    free(buffer);
+
+    if (written != size) {
+        fprintf(stderr, "Error: Short write to %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+bool state_load_file(cpu_t *cpu, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open save state %s\n", path);
+        return false;
+    }
+
+    u8 *buffer = malloc(STATE_MAX_SIZE);
+    if (!buffer) {
+        fclose(f);
+        return false;
+    }
+
+    size_t size = fread(buffer, 1, STATE_MAX_SIZE, f);
+    fclose(f);
+
+    bool loaded = state_load(cpu, buffer, size);
+    free(buffer);
+    return loaded;
+}
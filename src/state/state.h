@@ -0,0 +1,90 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include "utils/util.h"
+#include "cpu/cpu.h"
+
+#define STATE_MAGIC 0x54534132u  // "A2ST"
+#define STATE_VERSION 5
+#define STATE_PATH "./apple2.state"  // Hotkey save slot
+
+// Largest state: the core block plus every sector of both drives
+#define STATE_MAX_SIZE (sizeof(state_header_t) + sizeof(state_core_t) \
+                        + 2 * (sizeof(state_drive_t) + TRACKS * SECTORS * BYTES))
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 core_size;   // sizeof(state_core_t) when written, rejects states from other layouts
+    u32 drive_count;
+} state_header_t;
+
+// CPU registers, soft switches & keyboard latch
+typedef struct
+{
+    // Registers & Lazy Flags
+    u8 A, X, Y, SP;
+    u16 PC;
+    u8 B, D, I;
+    u8 v_result;
+    u16 nz_result;
+    u16 c_result;
+
+    // Soft Switches & Keyboard
+    bool text_mode;
+    bool low_res;
+    bool high_res;
+    bool mixed_mode;
+    u8 key_value;
+    bool key_ready;
+
+    // Disk II Controller
+    u8 disk_selected;
+    u8 disk_phases;
+    bool disk_motor_on;
+    bool disk_q6;
+    bool disk_q7;
+    u8 disk_latch;
+
+    u64 global_cycles;
+} state_regs_t;
+
+// Everything but the disks, copied in and out as one flat block
+typedef struct
+{
+    state_regs_t regs;
+    u8 memory[MEMORY_SIZE];
+} state_core_t;
+
+// Drive head position, followed by only the sectors written since the image was mounted
+typedef struct
+{
+    u32 image_size;      // Identity of the image the sectors are deltas against
+    u32 image_crc;
+    u8 current_track;
+    u8 half_track;
+    u8 phase;
+    u16 head_pos;
+    u64 spin_cycles;
+    u32 bit_pos;
+    u8 bit_remainder;
+    u8 shift;
+    u8 nibble;
+    u8 zero_run;
+    u8 format;
+    bool loaded;
+    bool write_protect;
+    u16 dirty_sectors[TRACKS];
+} state_drive_t;
+
+
+// Buffers must be 8-byte aligned, the core block is read and written in place
+void state_save_regs(const cpu_t *cpu, state_regs_t *regs);
+void state_load_regs(cpu_t *cpu, const state_regs_t *regs);
+size_t state_save(const cpu_t *cpu, u8 *buffer, size_t capacity);
+bool state_load(cpu_t *cpu, const u8 *buffer, size_t size);
+bool state_save_file(const cpu_t *cpu, const char *path);
+bool state_load_file(cpu_t *cpu, const char *path);
+
+#endif
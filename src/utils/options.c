@@ -0,0 +1,170 @@
+#include "options.h"
+#include "disk/rwts.h"
+
+void print_usage(const char *program)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --headless            Run without a window or frame throttling\n"
+        "  --disk1 FILE          Boot from the disk image in FILE (drive 1)\n"
+        "  --disk2 FILE          Mount the disk image in FILE in drive 2\n"
+        "  --fast-disk           Run flat out while a drive motor is on\n"
+        "  --rwts-trap           Serve DOS 3.3 RWTS sector calls straight from the image\n"
+        "  --rwts-cycles N       Cycles charged per trapped RWTS call (default 1000)\n"
+        "  --cycles N            Stop after N emulated cycles\n"
+        "  --until-pc ADDR       Stop when PC reaches ADDR (hex)\n"
+        "  --until-mem ADDR=VAL  Stop when memory at ADDR equals VAL (hex)\n"
+        "  --type TEXT           Type TEXT on the keyboard ('\\n' is Return)\n"
+        "  --dump-mem FILE       Write the 64 KB memory image to FILE at exit\n"
+        "  --dump-text           Print the 40x24 text screen at exit\n"
+        "  --load-state FILE     Start from the save state in FILE\n"
+        "  --save-state FILE     Write a save state to FILE when a headless run stops\n"
+        "  --rewind SECONDS      Keep SECONDS of history, F8 steps back a second\n"
+        "  --no-idle-skip        Don't fast-forward keyboard wait loops\n"
+        "  --mono                Monochrome hi-res display\n"
+        "  --no-sound            Keep the speaker silent\n"
+        "  --audio-sync          Pace emulation from the audio buffer instead of the clock\n"
+        "  --bench-hires N       Time the hi-res line kernels over N frames and exit\n",
+        program);
+}
+
+// Parse a hex value that must fit in max, e.g. "FD1B" or "$FD1B", ending at '=' when to_equals is set
+static bool parse_hex(const char *text, u32 max, bool to_equals, u32 *out)
+{
+    if (*text == '$') text++;
+
+    char *end;
+    unsigned long value = strtoul(text, &end, 16);
+    if (end == text || value > max) return false;
+
+    *out = value;
+    return to_equals ? *end == '=' : *end == '\0';
+}
+
+bool parse_options(options_t *options, int argc, char *argv[])
+{
+    memset(options, 0, sizeof(*options));
+    options->rwts_cycles = RWTS_DEFAULT_CYCLES;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        u32 parsed;
+
+        if (strcmp(arg, "--headless") == 0) {
+            options->headless = true;
+            continue;
+        }
+        if (strcmp(arg, "--dump-text") == 0) {
+            options->dump_text = true;
+            continue;
+        }
+        if (strcmp(arg, "--mono") == 0) {
+            options->mono = true;
+            continue;
+        }
+        if (strcmp(arg, "--fast-disk") == 0) {
+            options->fast_disk = true;
+            continue;
+        }
+        if (strcmp(arg, "--rwts-trap") == 0) {
+            options->rwts_trap = true;
+            continue;
+        }
+        if (strcmp(arg, "--no-idle-skip") == 0) {
+            options->no_idle_skip = true;
+            continue;
+        }
+        if (strcmp(arg, "--no-sound") == 0) {
+            options->no_sound = true;
+            continue;
+        }
+        if (strcmp(arg, "--audio-sync") == 0) {
+            options->audio_sync = true;
+            continue;
+        }
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            return false;
+        }
+
+        // Everything below takes an argument
+        if (value == NULL) {
+            fprintf(stderr, "Error: %s needs a value\n", arg);
+            return false;
+        }
+        i++;
+
+        if (strcmp(arg, "--cycles") == 0) {
+            char *end;
+            options->max_cycles = strtoull(value, &end, 0);
+            if (*end != '\0' || options->max_cycles == 0) {
+                fprintf(stderr, "Error: invalid cycle count %s\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--until-pc") == 0) {
+            if (!parse_hex(value, 0xFFFF, false, &parsed)) {
+                fprintf(stderr, "Error: invalid address %s\n", value);
+                return false;
+            }
+            options->stop_on_pc = true;
+            options->stop_pc = parsed;
+        } else if (strcmp(arg, "--until-mem") == 0) {
+            const char *equals = strchr(value, '=');
+            u32 mem_value;
+            if (!equals || !parse_hex(value, 0xFFFF, true, &parsed) || !parse_hex(equals + 1, 0xFF, false, &mem_value)) {
+                fprintf(stderr, "Error: expected ADDR=VAL, got %s\n", value);
+                return false;
+            }
+            options->stop_on_mem = true;
+            options->stop_mem_addr = parsed;
+            options->stop_mem_value = mem_value;
+        } else if (strcmp(arg, "--bench-hires") == 0) {
+            char *end;
+            long frames = strtol(value, &end, 0);
+            if (*end != '\0' || frames <= 0 || frames > 1000000) {
+                fprintf(stderr, "Error: invalid frame count %s\n", value);
+                return false;
+            }
+            options->bench_hires = frames;
+        } else if (strcmp(arg, "--rewind") == 0) {
+            char *end;
+            long seconds = strtol(value, &end, 0);
+            if (*end != '\0' || seconds <= 0 || seconds > 3600) {
+                fprintf(stderr, "Error: invalid rewind length %s\n", value);
+                return false;
+            }
+            options->rewind_seconds = seconds;
+        } else if (strcmp(arg, "--type") == 0) {
+            options->type_text = value;
+        } else if (strcmp(arg, "--dump-mem") == 0) {
+            options->dump_mem_path = value;
+        } else if (strcmp(arg, "--disk1") == 0) {
+            options->disk1_path = value;
+        } else if (strcmp(arg, "--disk2") == 0) {
+            options->disk2_path = value;
+        } else if (strcmp(arg, "--rwts-cycles") == 0) {
+            char *end;
+            unsigned long cycles = strtoul(value, &end, 0);
+            if (*end != '\0' || cycles > 0xFFFFFFFFul) {
+                fprintf(stderr, "Error: invalid cycle count %s\n", value);
+                return false;
+            }
+            options->rwts_cycles = cycles;
+        } else if (strcmp(arg, "--load-state") == 0) {
+            options->load_state_path = value;
+        } else if (strcmp(arg, "--save-state") == 0) {
+            options->save_state_path = value;
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", arg);
+            return false;
+        }
+    }
+
+    // Headless runs need something to stop them
+    if (options->headless && !options->max_cycles && !options->stop_on_pc && !options->stop_on_mem) {
+        fprintf(stderr, "Error: --headless needs --cycles, --until-pc or --until-mem\n");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "utils/util.h"
+
+typedef struct
+{
+    // Headless Mode
+    bool headless;
+    bool no_idle_skip;        // Emulate keyboard wait loops instead of skipping them
+    u64 max_cycles;           // 0 = no limit
+    bool stop_on_pc;
+    u16 stop_pc;
+    bool stop_on_mem;
+    u16 stop_mem_addr;
+    u8 stop_mem_value;
+
+    // Display
+    bool mono;                // Monochrome hi-res instead of NTSC artifact colour
+    int rewind_seconds;       // History kept for F8 rewind, 0 = off
+    int bench_hires;          // Frames to time the hi-res kernels over, 0 = off
+    bool no_sound;            // Leave the speaker silent and the audio device closed
+    bool audio_sync;          // Let the audio buffer's fill level pace emulation
+
+    // Disks
+    const char *disk1_path;
+    const char *disk2_path;
+    bool fast_disk;           // Accelerate while a drive motor is on
+    bool rwts_trap;           // Serve DOS 3.3 RWTS calls straight from the image
+    u32 rwts_cycles;          // Cycles charged per trapped call
+
+    // Input & Output
+    const char *type_text;    // Typed into the keyboard latch as the program polls it
+    const char *dump_mem_path;
+    const char *load_state_path;  // Restored after the ROM is loaded
+    const char *save_state_path;  // Written when a headless run stops
+    bool dump_text;
+} options_t;
+
+bool parse_options(options_t *options, int argc, char *argv[]);
+void print_usage(const char *program);
+
+#endif
@@ -0,0 +1,255 @@
+#include "cpu/cpu.h"
+
+// Lazy flag conformance: random walks of single instructions run on the emulator
+// and on an eager model that keeps N, V, Z and C as plain bits, the way cpu_t did
+// before flags were decoded on demand. Each step starts from the state the last
+// one left, so lazy results feed the next instruction's flag reads.
+
+#define WALKS 400
+#define STEPS 1000
+#define CODE_ADDR 0x0300
+#define ZP_ADDR 0x10
+
+// Eager model of the registers the walk touches
+typedef struct
+{
+    u8 A, X, Y, SP;
+    u8 P;          // Packed status, B and bit 5 always set like get_status
+    u16 PC;
+} model_t;
+
+enum OPERAND
+{
+    NONE,          // Implied or accumulator
+    IMMEDIATE,
+    ZERO_PAGE,     // Read-modify-write or BIT on ZP_ADDR
+    BRANCH
+};
+
+typedef struct
+{
+    u8 opcode;
+    enum OPERAND operand;
+} op_t;
+
+static const op_t ops[] = {
+    { 0x69, IMMEDIATE }, { 0xE9, IMMEDIATE },    // ADC, SBC
+    { 0x29, IMMEDIATE }, { 0x09, IMMEDIATE }, { 0x49, IMMEDIATE },  // AND, ORA, EOR
+    { 0xC9, IMMEDIATE }, { 0xE0, IMMEDIATE }, { 0xC0, IMMEDIATE },  // CMP, CPX, CPY
+    { 0xA9, IMMEDIATE }, { 0xA2, IMMEDIATE }, { 0xA0, IMMEDIATE },  // LDA, LDX, LDY
+    { 0x24, ZERO_PAGE }, { 0xE6, ZERO_PAGE }, { 0xC6, ZERO_PAGE },  // BIT, INC, DEC
+    { 0x06, ZERO_PAGE }, { 0x46, ZERO_PAGE }, { 0x26, ZERO_PAGE }, { 0x66, ZERO_PAGE },  // ASL, LSR, ROL, ROR
+    { 0x0A, NONE }, { 0x4A, NONE }, { 0x2A, NONE }, { 0x6A, NONE },  // ASL A, LSR A, ROL A, ROR A
+    { 0xE8, NONE }, { 0xC8, NONE }, { 0xCA, NONE }, { 0x88, NONE },  // INX, INY, DEX, DEY
+    { 0xAA, NONE }, { 0xA8, NONE }, { 0x8A, NONE }, { 0x98, NONE }, { 0xBA, NONE },  // TAX, TAY, TXA, TYA, TSX
+    { 0x68, NONE }, { 0x28, NONE }, { 0x08, NONE },  // PLA, PLP, PHP
+    { 0x18, NONE }, { 0x38, NONE }, { 0xB8, NONE },  // CLC, SEC, CLV
+    { 0xF8, NONE }, { 0xD8, NONE },                  // SED, CLD
+    { 0x10, BRANCH }, { 0x30, BRANCH }, { 0x50, BRANCH }, { 0x70, BRANCH },  // BPL, BMI, BVC, BVS
+    { 0x90, BRANCH }, { 0xB0, BRANCH }, { 0xD0, BRANCH }, { 0xF0, BRANCH }   // BCC, BCS, BNE, BEQ
+};
+
+static u32 seed = 0x6502;
+
+static u8 random_byte(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed & 0xFF;
+}
+
+static void set_bit(model_t *m, u8 flag, bool on)
+{
+    m->P = on ? m->P | flag : m->P & ~flag;
+}
+
+static bool get_bit(const model_t *m, u8 flag)
+{
+    return (m->P & flag) != 0;
+}
+
+static u8 set_nz(model_t *m, u8 value)
+{
+    set_bit(m, ZERO_FLAG, value == 0);
+    set_bit(m, NEGATIVE_FLAG, value & 0x80);
+    return value;
+}
+
+static void compare(model_t *m, u8 reg, u8 value)
+{
+    set_bit(m, CARRY_FLAG, reg >= value);
+    set_nz(m, reg - value);
+}
+
+static void adc(model_t *m, u8 value)
+{
+    u8 carry = get_bit(m, CARRY_FLAG);
+    u16 result = m->A + value + carry;
+
+    if (get_bit(m, DECIMAL_FLAG)) {
+        if ((m->A & 0x0F) + (value & 0x0F) + carry > 9) result += 6;
+        if (result > 0x99) result += 0x60;
+    }
+
+    set_bit(m, CARRY_FLAG, result & 0x100);
+    set_bit(m, OVERFLOW_FLAG, (m->A ^ result) & (value ^ result) & 0x80);
+    m->A = set_nz(m, result & 0xFF);
+}
+
+static void sbc(model_t *m, u8 value)
+{
+    u16 result = m->A - value - !get_bit(m, CARRY_FLAG);
+    set_bit(m, CARRY_FLAG, result < 0x100);
+    set_bit(m, OVERFLOW_FLAG, (m->A ^ result) & (~value ^ result) & 0x80);
+
+    if (get_bit(m, DECIMAL_FLAG)) {
+        if ((m->A & 0x0F) - !get_bit(m, CARRY_FLAG) < (value & 0x0F)) result -= 0x06;
+        if (result > 0x99) result -= 0x60;
+    }
+
+    m->A = set_nz(m, result & 0xFF);
+}
+
+static u8 shift(model_t *m, u8 opcode, u8 value)
+{
+    u8 carry = get_bit(m, CARRY_FLAG);
+
+    switch (opcode & 0xE0) {
+        case 0x00:  // ASL
+            set_bit(m, CARRY_FLAG, value & 0x80);
+            return set_nz(m, value << 1);
+        case 0x20:  // ROL
+            set_bit(m, CARRY_FLAG, value & 0x80);
+            return set_nz(m, (value << 1) | carry);
+        case 0x40:  // LSR
+            set_bit(m, CARRY_FLAG, value & 1);
+            return set_nz(m, value >> 1);
+        default:    // ROR
+            set_bit(m, CARRY_FLAG, value & 1);
+            return set_nz(m, (value >> 1) | (carry << 7));
+    }
+}
+
+static bool branch_taken(const model_t *m, u8 opcode)
+{
+    static const u8 flags[4] = { NEGATIVE_FLAG, OVERFLOW_FLAG, CARRY_FLAG, ZERO_FLAG };
+    return get_bit(m, flags[opcode >> 6]) == ((opcode & 0x20) != 0);
+}
+
+// Run one instruction on the model, memory is shared with the emulator's copy
+static void model_step(model_t *m, u8 *memory, const op_t *op, u8 operand)
+{
+    u8 *zp = &memory[ZP_ADDR];
+    m->PC = CODE_ADDR + (op->operand == NONE ? 1 : 2);
+
+    switch (op->opcode) {
+        case 0x69: adc(m, operand); break;
+        case 0xE9: sbc(m, operand); break;
+        case 0x29: m->A = set_nz(m, m->A & operand); break;
+        case 0x09: m->A = set_nz(m, m->A | operand); break;
+        case 0x49: m->A = set_nz(m, m->A ^ operand); break;
+        case 0xC9: compare(m, m->A, operand); break;
+        case 0xE0: compare(m, m->X, operand); break;
+        case 0xC0: compare(m, m->Y, operand); break;
+        case 0xA9: m->A = set_nz(m, operand); break;
+        case 0xA2: m->X = set_nz(m, operand); break;
+        case 0xA0: m->Y = set_nz(m, operand); break;
+        case 0x24:
+            set_bit(m, ZERO_FLAG, (m->A & *zp) == 0);
+            set_bit(m, NEGATIVE_FLAG, *zp & 0x80);
+            set_bit(m, OVERFLOW_FLAG, *zp & 0x40);
+            break;
+        case 0xE6: *zp = set_nz(m, *zp + 1); break;
+        case 0xC6: *zp = set_nz(m, *zp - 1); break;
+        case 0x06: case 0x46: case 0x26: case 0x66: *zp = shift(m, op->opcode, *zp); break;
+        case 0x0A: case 0x4A: case 0x2A: case 0x6A: m->A = shift(m, op->opcode, m->A); break;
+        case 0xE8: m->X = set_nz(m, m->X + 1); break;
+        case 0xC8: m->Y = set_nz(m, m->Y + 1); break;
+        case 0xCA: m->X = set_nz(m, m->X - 1); break;
+        case 0x88: m->Y = set_nz(m, m->Y - 1); break;
+        case 0xAA: m->X = set_nz(m, m->A); break;
+        case 0xA8: m->Y = set_nz(m, m->A); break;
+        case 0x8A: m->A = set_nz(m, m->X); break;
+        case 0x98: m->A = set_nz(m, m->Y); break;
+        case 0xBA: m->X = set_nz(m, m->SP); break;
+        case 0x68: m->A = set_nz(m, memory[0x100 | ++m->SP]); break;
+        case 0x28: m->P = memory[0x100 | ++m->SP] | BREAK_FLAG | 0x20; break;
+        case 0x08: memory[0x100 | m->SP--] = m->P; break;
+        case 0x18: set_bit(m, CARRY_FLAG, false); break;
+        case 0x38: set_bit(m, CARRY_FLAG, true); break;
+        case 0xB8: set_bit(m, OVERFLOW_FLAG, false); break;
+        case 0xF8: set_bit(m, DECIMAL_FLAG, true); break;
+        case 0xD8: set_bit(m, DECIMAL_FLAG, false); break;
+        default:
+            if (branch_taken(m, op->opcode)) m->PC += (i8)operand;
+            break;
+    }
+}
+
+static bool check(const cpu_t *cpu, const model_t *m, const u8 *expected, const op_t *op, u8 operand,
+                  int walk, int step)
+{
+    u8 status = get_status(cpu);
+    bool ok = cpu->A == m->A && cpu->X == m->X && cpu->Y == m->Y && cpu->SP == m->SP
+        && cpu->PC == m->PC && status == m->P && memcmp(cpu->memory, expected, 0x200) == 0;
+    if (ok) return true;
+
+    fprintf(stderr, "Walk %d step %d: opcode %02X operand %02X\n", walk, step, op->opcode, operand);
+    fprintf(stderr, "  emulator A=%02X X=%02X Y=%02X SP=%02X PC=%04X P=%02X\n",
+            cpu->A, cpu->X, cpu->Y, cpu->SP, cpu->PC, status);
+    fprintf(stderr, "  eager    A=%02X X=%02X Y=%02X SP=%02X PC=%04X P=%02X\n",
+            m->A, m->X, m->Y, m->SP, m->PC, m->P);
+    return false;
+}
+
+int main(void)
+{
+    cpu_t *cpu = cpu_create();
+    if (!cpu) return EXIT_FAILURE;
+
+    // Zero page and stack as the model expects them after each step
+    static u8 expected[0x200];
+    int failures = 0;
+    u64 steps = 0;
+
+    for (int walk = 0; walk < WALKS && failures < 10; walk++) {
+        model_t m = { random_byte(), random_byte(), random_byte(), random_byte(), 0, CODE_ADDR };
+        m.P = random_byte() | BREAK_FLAG | 0x20;
+
+        cpu->A = m.A;
+        cpu->X = m.X;
+        cpu->Y = m.Y;
+        cpu->SP = m.SP;
+        set_status(cpu, m.P);
+
+        for (int step = 0; step < STEPS && failures < 10; step++) {
+            const op_t *op = &ops[random_byte() % (sizeof(ops) / sizeof(ops[0]))];
+            u8 operand = random_byte();
+
+            // Fresh memory and stack operands for every step
+            cpu->memory[ZP_ADDR] = random_byte();
+            cpu->memory[0x100 | (u8)(m.SP + 1)] = random_byte();
+            cpu->memory[CODE_ADDR] = op->opcode;
+            cpu->memory[CODE_ADDR + 1] = op->operand == ZERO_PAGE ? ZP_ADDR : operand;
+            memcpy(expected, cpu->memory, sizeof(expected));
+
+            model_step(&m, expected, op, op->operand == ZERO_PAGE ? expected[ZP_ADDR] : operand);
+
+            cpu->PC = CODE_ADDR;
+            cpu_run(cpu, cpu->global_cycles + 1);
+            steps++;
+
+            if (!check(cpu, &m, expected, op, operand, walk, step)) failures++;
+        }
+    }
+
+    cpu_destroy(cpu);
+
+    if (failures) {
+        fprintf(stderr, "flags_conformance: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("flags_conformance: %llu instructions match the eager model\n", (unsigned long long)steps);
+    return EXIT_SUCCESS;
+}